@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "csv_replay.h"
+#include "csv_scan.h"
+#include "matching_engine.h"
+#include "price_parse.h"
+#include "replay_rows.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchResult {
+    std::string name;
+    std::size_t operations = 0;
+    // Input bytes, for throughput workloads; printed as GB/s when set.
+    std::size_t bytes = 0;
+    double seconds = 0.0;
+    std::size_t checksum = 0;
+};
+
+class Lcg {
+public:
+    explicit Lcg(std::uint64_t seed) : state_(seed) {}
+
+    std::uint64_t next(std::uint64_t bound) {
+        state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (state_ >> 33) % bound;
+    }
+
+private:
+    std::uint64_t state_;
+};
+
+EngineConfig make_config(LadderBackend ladder) {
+    EngineConfig config;
+    config.book.ladder = ladder;
+    config.book.dense_tick_size = price_to_ticks(0.01);
+    return config;
+}
+
+const char* ladder_to_cstr(LadderBackend ladder) {
+    return ladder == LadderBackend::DENSE ? "dense" : "map";
+}
+
+// Passive flow around a slowly drifting touch: adds, cancels, and small crossing orders.
+BenchResult run_churn(LadderBackend ladder, std::size_t operations) {
+    MatchingEngine engine(make_config(ladder));
+    Lcg rng(42);
+    std::vector<int> live_ids;
+    live_ids.reserve(operations);
+
+    const PriceTicks tick = price_to_ticks(0.01);
+    int next_id = 1;
+    std::size_t sink = 0;
+
+    const auto start = Clock::now();
+    for (std::size_t i = 0; i < operations; ++i) {
+        const PriceTicks mid = price_to_ticks(100.0) + static_cast<PriceTicks>(i / 1000) * tick;
+        const std::uint64_t action = rng.next(10);
+        if (action < 3 && !live_ids.empty()) {
+            const std::size_t pick = rng.next(live_ids.size());
+            sink += engine.cancel(live_ids[pick]) ? 1 : 0;
+            live_ids[pick] = live_ids.back();
+            live_ids.pop_back();
+            continue;
+        }
+
+        const Side side = rng.next(2) == 0 ? Side::BUY : Side::SELL;
+        const PriceTicks offset = static_cast<PriceTicks>(rng.next(20)) * tick;
+        const PriceTicks price = side == Side::BUY ? mid - offset + tick : mid + offset - tick;
+        const int quantity = 1 + static_cast<int>(rng.next(20));
+        const int id = next_id++;
+        const SubmitResult result = engine.submit({id, side, price, quantity});
+        sink += result.trades.size();
+        live_ids.push_back(id);
+    }
+    const auto stop = Clock::now();
+
+    BenchResult bench;
+    bench.name = std::string("churn/") + ladder_to_cstr(ladder);
+    bench.operations = operations;
+    bench.seconds = std::chrono::duration<double>(stop - start).count();
+    bench.checksum = sink;
+    return bench;
+}
+
+// Deep resting book swept by one large market order, rebuilt on a fresh engine each
+// round so the event log stays small. Only the sweeping submit is timed; ops are trades.
+BenchResult run_sweep(LadderBackend ladder, std::size_t rounds) {
+    const PriceTicks tick = price_to_ticks(0.01);
+    constexpr int kLevels = 50;
+    constexpr int kOrdersPerLevel = 20;
+    constexpr int kOrderQuantity = 5;
+
+    std::size_t trades = 0;
+    std::size_t checksum = 0;
+    double seconds = 0.0;
+
+    for (std::size_t round = 0; round < rounds; ++round) {
+        MatchingEngine engine(make_config(ladder));
+        int next_id = 1;
+        const Side resting_side = round % 2 == 0 ? Side::SELL : Side::BUY;
+        for (int level = 0; level < kLevels; ++level) {
+            const PriceTicks price = resting_side == Side::SELL
+                                         ? price_to_ticks(100.0) + level * tick
+                                         : price_to_ticks(99.0) - level * tick;
+            for (int i = 0; i < kOrdersPerLevel; ++i) {
+                engine.submit({next_id++, resting_side, price, kOrderQuantity});
+            }
+        }
+
+        const Side aggressor = resting_side == Side::SELL ? Side::BUY : Side::SELL;
+        const auto start = Clock::now();
+        const SubmitResult result = engine.submit({next_id++,
+                                                   aggressor,
+                                                   0,
+                                                   kLevels * kOrdersPerLevel * kOrderQuantity,
+                                                   TimeInForce::IOC,
+                                                   OrderType::MARKET});
+        seconds += std::chrono::duration<double>(Clock::now() - start).count();
+        trades += result.trades.size();
+        checksum += engine.bids().order_count() + engine.asks().order_count() + next_id;
+    }
+
+    BenchResult bench;
+    bench.name = std::string("sweep/") + ladder_to_cstr(ladder);
+    bench.operations = trades;
+    bench.seconds = seconds;
+    bench.checksum = checksum;
+    return bench;
+}
+
+enum class PriceParser { STREAM_DOUBLE, FROM_CHARS_DOUBLE, DECIMAL };
+
+const char* price_parser_to_cstr(PriceParser parser) {
+    switch (parser) {
+        case PriceParser::STREAM_DOUBLE:
+            return "stream_double";
+        case PriceParser::FROM_CHARS_DOUBLE:
+            return "from_chars";
+        case PriceParser::DECIMAL:
+            return "decimal";
+    }
+    return "unknown";
+}
+
+std::vector<std::string> make_price_texts(std::size_t count) {
+    Lcg rng(7);
+    std::vector<std::string> texts;
+    texts.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::ostringstream oss;
+        oss << std::fixed << std::setprecision(4) << ticks_to_price(static_cast<PriceTicks>(rng.next(20000000)));
+        texts.push_back(oss.str());
+    }
+    return texts;
+}
+
+// CSV price field to PriceTicks: the old istringstream/double path, from_chars/double,
+// and the integer decimal parser.
+BenchResult run_price_parse(PriceParser parser, const std::vector<std::string>& texts) {
+    std::size_t checksum = 0;
+    const auto start = Clock::now();
+    for (const std::string& text : texts) {
+        PriceTicks ticks = 0;
+        if (parser == PriceParser::STREAM_DOUBLE) {
+            std::istringstream iss(text);
+            double price = 0.0;
+            iss >> price;
+            ticks = price_to_ticks(price);
+        } else if (parser == PriceParser::FROM_CHARS_DOUBLE) {
+            double price = 0.0;
+            std::from_chars(text.data(), text.data() + text.size(), price);
+            ticks = price_to_ticks(price);
+        } else {
+            parse_decimal_price_ticks(text, ticks);
+        }
+        checksum += static_cast<std::size_t>(ticks);
+    }
+    const auto stop = Clock::now();
+
+    BenchResult bench;
+    bench.name = std::string("price/") + price_parser_to_cstr(parser);
+    bench.operations = texts.size();
+    bench.seconds = std::chrono::duration<double>(stop - start).count();
+    bench.checksum = checksum;
+    return bench;
+}
+
+// Replay CSV text shaped like tests/data: short numeric fields, mostly empty tails, and
+// an occasional free-text note.
+std::string make_replay_text(std::size_t rows) {
+    static const char* const kNotes[] = {"", "", "", "crosses earlier seq", "price up replace should cross"};
+    Lcg rng(11);
+    std::ostringstream oss;
+    oss << "ts_ns,seq,action,order_id,side,type,price,qty,tif,new_price,new_qty,notes\n";
+    for (std::size_t i = 0; i < rows; ++i) {
+        const char* const note = kNotes[rng.next(5)];
+        const std::uint64_t price = 9900 + rng.next(200);
+        switch (rng.next(4)) {
+            case 0:
+                oss << 100 + i << ",1,CANCEL," << i << ",,,,,,,," << note << '\n';
+                break;
+            case 1:
+                oss << 100 + i << ",1,REPLACE," << i << ",,,,,," << price / 100 << '.' << price % 100
+                    << "00," << 1 + rng.next(50) << ',' << note << '\n';
+                break;
+            default:
+                oss << 100 + i << ",1,NEW," << i + 1 << (rng.next(2) == 0 ? ",BUY" : ",SELL") << ",LIMIT,"
+                    << price / 100 << '.' << price % 100 << "00," << 1 + rng.next(50) << ",GTC,,," << note
+                    << '\n';
+                break;
+        }
+    }
+    return oss.str();
+}
+
+// Line and comma discovery over a whole replay text: the string_view::find sequence the
+// tokenizer used before (newline, quote check, then comma by comma) against each scan kernel.
+BenchResult run_line_scan(const char* name, const std::string& text, const CsvScanKernel* kernel) {
+    std::uint32_t commas[12];
+    std::size_t checksum = 0;
+    const std::string_view view(text);
+    const auto start = Clock::now();
+    std::size_t cursor = 0;
+    while (cursor < view.size()) {
+        if (kernel == nullptr) {
+            const std::size_t newline = view.find('\n', cursor);
+            const std::size_t line_end = newline == std::string_view::npos ? view.size() : newline;
+            const std::string_view line = view.substr(cursor, line_end - cursor);
+            checksum += line.find('"') == std::string_view::npos ? 0 : 1;
+            for (std::size_t comma = line.find(','); comma != std::string_view::npos; comma = line.find(',', comma + 1)) {
+                checksum += comma;
+            }
+            cursor = line_end + 1;
+        } else {
+            const CsvLineScan scan =
+                scan_csv_line(*kernel, view.data() + cursor, view.data() + view.size(), commas, 12);
+            checksum += scan.has_quote ? 1 : 0;
+            for (std::size_t i = 0; i < std::min<std::size_t>(scan.comma_count, 12); ++i) {
+                checksum += commas[i];
+            }
+            cursor += scan.length + 1;
+        }
+    }
+    const auto stop = Clock::now();
+
+    BenchResult bench;
+    bench.name = std::string("scan/") + name;
+    bench.operations = text.size();
+    bench.bytes = text.size();
+    bench.seconds = std::chrono::duration<double>(stop - start).count();
+    bench.checksum = checksum;
+    return bench;
+}
+
+// Whole-file parse of `path` with a fixed number of worker threads.
+BenchResult run_parse_file(const std::string& path, std::size_t thread_count) {
+    ReplayParseOptions options;
+    options.thread_count = thread_count;
+    std::vector<ReplayRow> rows;
+    std::string error;
+    const auto start = Clock::now();
+    const bool ok = parse_replay_csv_rows(path, rows, error, options);
+    const auto stop = Clock::now();
+
+    BenchResult bench;
+    bench.name = "parse/threads=" + std::to_string(thread_count);
+    bench.operations = rows.size();
+    bench.bytes = static_cast<std::size_t>(std::filesystem::file_size(path));
+    bench.seconds = std::chrono::duration<double>(stop - start).count();
+    bench.checksum = ok ? rows.size() : 0;
+    return bench;
+}
+
+enum class RowOrder {
+    SORTED,
+    NEARLY_SORTED,
+    SHUFFLED,
+};
+
+const char* row_order_to_cstr(RowOrder order) {
+    switch (order) {
+        case RowOrder::SORTED:
+            return "sorted";
+        case RowOrder::NEARLY_SORTED:
+            return "nearly";
+        case RowOrder::SHUFFLED:
+            return "shuffled";
+    }
+    return "unknown";
+}
+
+// Parsed rows as a replay file would produce them: nanosecond timestamps `gap_ns` apart, a
+// small seq, and row_index in file order. Nearly sorted files have timestamps up to 64 rows
+// early or late; shuffled ones are in no order at all.
+std::vector<ReplayRow> make_sort_rows(std::size_t count, RowOrder order, std::uint64_t gap_ns) {
+    Lcg rng(23);
+    std::vector<std::uint64_t> timestamps(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        timestamps[i] = 1700000000000000000ULL + i * gap_ns;
+        if (order == RowOrder::NEARLY_SORTED) {
+            timestamps[i] += rng.next(128 * gap_ns);
+        }
+    }
+    if (order == RowOrder::SHUFFLED) {
+        for (std::size_t i = count; i > 1; --i) {
+            std::swap(timestamps[i - 1], timestamps[rng.next(i)]);
+        }
+    }
+
+    std::vector<ReplayRow> rows(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        rows[i].ts_ns = timestamps[i];
+        rows[i].seq = rng.next(4);
+        rows[i].row_index = i;
+        rows[i].order_id = static_cast<int>(i);
+    }
+    return rows;
+}
+
+// Replay-order sort of a copy of `rows`: std::sort on the row comparator, as the loader
+// used to do, against sort_replay_rows.
+BenchResult run_sort(const std::vector<ReplayRow>& rows, const std::string& label, bool radix) {
+    std::vector<ReplayRow> sorted = rows;
+    const auto start = Clock::now();
+    if (radix) {
+        sort_replay_rows(sorted);
+    } else {
+        std::sort(sorted.begin(), sorted.end(), replay_row_before);
+    }
+    const auto stop = Clock::now();
+
+    BenchResult bench;
+    bench.name = std::string(radix ? "sort/radix/" : "sort/std/") + label;
+    bench.operations = sorted.size();
+    bench.seconds = std::chrono::duration<double>(stop - start).count();
+    bench.checksum = static_cast<std::size_t>(sorted.front().order_id) + static_cast<std::size_t>(sorted.back().order_id);
+    return bench;
+}
+
+// write_replay_trades_csv over `count` synthetic fills.
+BenchResult run_write_trades(std::size_t count) {
+    Lcg rng(29);
+    std::vector<ReplayTradeRecord> trades(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        trades[i] = {1700000000000000000ULL + i * 1000, 1 + rng.next(4), static_cast<int>(i + 1),
+                     static_cast<int>(i + 2), static_cast<PriceTicks>(990000 + rng.next(20000)),
+                     static_cast<int>(1 + rng.next(100))};
+    }
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "matching_engine_bench_trades.csv";
+    std::string error;
+    const auto start = Clock::now();
+    const bool ok = write_replay_trades_csv(path.string(), trades, error);
+    const auto stop = Clock::now();
+
+    BenchResult bench;
+    bench.name = "write/trades";
+    bench.operations = count;
+    bench.bytes = ok ? static_cast<std::size_t>(std::filesystem::file_size(path)) : 0;
+    bench.seconds = std::chrono::duration<double>(stop - start).count();
+    bench.checksum = bench.bytes;
+    std::filesystem::remove(path);
+    return bench;
+}
+
+// Best of several repeats; single runs on a shared box are too noisy to compare.
+template <typename Workload>
+BenchResult best_of(std::size_t repeats, Workload&& workload) {
+    BenchResult best = workload();
+    for (std::size_t i = 1; i < repeats; ++i) {
+        BenchResult candidate = workload();
+        if (candidate.seconds < best.seconds) {
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+void print_result(const BenchResult& result) {
+    const double ns_per_op =
+        result.operations == 0 ? 0.0 : result.seconds * 1e9 / static_cast<double>(result.operations);
+    std::cout << std::left << std::setw(20) << result.name
+              << std::right << std::setw(12) << result.operations << " ops"
+              << std::setw(12) << std::fixed << std::setprecision(2) << ns_per_op << " ns/op";
+    if (result.bytes != 0) {
+        std::cout << std::setw(10) << static_cast<double>(result.bytes) / result.seconds / 1e9 << " GB/s";
+    }
+    std::cout << "  (checksum " << result.checksum << ")\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::size_t scale = 1;
+    if (argc > 1) {
+        scale = static_cast<std::size_t>(std::stoul(argv[1]));
+    }
+
+    for (const LadderBackend ladder : {LadderBackend::MAP, LadderBackend::DENSE}) {
+        print_result(best_of(3, [&] { return run_churn(ladder, 1000000 * scale); }));
+        print_result(best_of(5, [&] { return run_sweep(ladder, 1000 * scale); }));
+    }
+
+    const std::vector<std::string> price_texts = make_price_texts(1000000 * scale);
+    for (const PriceParser parser :
+         {PriceParser::STREAM_DOUBLE, PriceParser::FROM_CHARS_DOUBLE, PriceParser::DECIMAL}) {
+        print_result(best_of(3, [&] { return run_price_parse(parser, price_texts); }));
+    }
+
+    const std::string replay_text = make_replay_text(2000000 * scale);
+    print_result(best_of(3, [&] { return run_line_scan("find", replay_text, nullptr); }));
+    for (const CsvScanKernel kernel : {CsvScanKernel::SCALAR, CsvScanKernel::SSE2, CsvScanKernel::AVX2}) {
+        if (csv_scan_kernel_supported(kernel)) {
+            print_result(best_of(3, [&] { return run_line_scan(csv_scan_kernel_name(kernel), replay_text, &kernel); }));
+        }
+    }
+
+    const std::filesystem::path replay_path =
+        std::filesystem::temp_directory_path() / "matching_engine_bench_replay.csv";
+    {
+        std::ofstream out(replay_path, std::ios::binary);
+        out << replay_text;
+    }
+    const std::size_t max_threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    for (std::size_t threads = 1;; threads = std::min(threads * 2, max_threads)) {
+        print_result(best_of(3, [&] { return run_parse_file(replay_path.string(), threads); }));
+        if (threads == max_threads) {
+            break;
+        }
+    }
+    std::filesystem::remove(replay_path);
+    std::cout << "rows/ReplayRow      " << std::setw(12) << sizeof(ReplayRow) << " bytes/row\n";
+
+    print_result(best_of(3, [&] { return run_write_trades(1000000 * scale); }));
+
+    for (const RowOrder order : {RowOrder::SORTED, RowOrder::NEARLY_SORTED, RowOrder::SHUFFLED}) {
+        const std::vector<ReplayRow> rows = make_sort_rows(1000000 * scale, order, 1000);
+        const std::string label = row_order_to_cstr(order);
+        print_result(best_of(3, [&] { return run_sort(rows, label, false); }));
+        print_result(best_of(3, [&] { return run_sort(rows, label, true); }));
+    }
+
+    // Captures spread over a 6.5 hour session: the timestamp range alone takes 45 bits, so
+    // with the row position the keys no longer fit one word.
+    constexpr std::uint64_t kSessionNs = 23400ULL * 1000000000ULL;
+    for (const std::size_t count : {1000000 * scale, 10000000 * scale}) {
+        for (const RowOrder order : {RowOrder::NEARLY_SORTED, RowOrder::SHUFFLED}) {
+            const std::vector<ReplayRow> rows = make_sort_rows(count, order, kSessionNs / count);
+            const std::string label =
+                "session-" + std::to_string(count / 1000000) + "M/" + row_order_to_cstr(order);
+            print_result(best_of(3, [&] { return run_sort(rows, label, false); }));
+            print_result(best_of(3, [&] { return run_sort(rows, label, true); }));
+        }
+    }
+    return 0;
+}
@@ -14,6 +14,7 @@
 #include <system_error>
 #include <vector>
 
+#include "csv_writer.h"
 #include "execution_backtest.h"
 
 namespace {
@@ -290,12 +291,6 @@ const char* strategy_to_cstr(ExecutionStrategy strategy) {
     return "UNKNOWN";
 }
 
-std::string format_price(PriceTicks ticks) {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(4) << ticks_to_price(ticks);
-    return oss.str();
-}
-
 std::string format_double(double value, int decimals = 6) {
     std::ostringstream oss;
     oss << std::fixed << std::setprecision(decimals) << value;
@@ -343,57 +338,70 @@ bool write_runs_csv(const std::string& output_path,
         return false;
     }
 
-    std::ofstream output(output_path);
-    if (!output.is_open()) {
+    CsvWriter output;
+    if (!output.open(output_path)) {
         out_error = "failed to open runs output CSV: " + output_path;
         return false;
     }
 
-    output << "run_id,dataset,side,qty,slices,strategy,status,error,"
-              "filled_qty,target_qty,fill_rate,avg_fill_price,"
-              "arrival_benchmark_name,arrival_benchmark_price,shortfall_bps,participation_rate,"
-              "replay_rows,replay_trades\n";
+    output.put("run_id,dataset,side,qty,slices,strategy,status,error,"
+               "filled_qty,target_qty,fill_rate,avg_fill_price,"
+               "arrival_benchmark_name,arrival_benchmark_price,shortfall_bps,participation_rate,"
+               "replay_rows,replay_trades\n");
 
     for (const auto& run : runs) {
-        output << run.run_id << ','
-               << csv_escape(run.request.dataset) << ','
-               << side_to_cstr(run.request.side) << ','
-               << run.request.quantity << ','
-               << run.request.slices << ','
-               << strategy_to_cstr(run.request.strategy) << ','
-               << (run.success ? "SUCCESS" : "FAILED") << ','
-               << csv_escape(run.error) << ',';
+        output.put_int(run.run_id);
+        output.put(',');
+        output.put(csv_escape(run.request.dataset));
+        output.put(',');
+        output.put(side_to_cstr(run.request.side));
+        output.put(',');
+        output.put_int(run.request.quantity);
+        output.put(',');
+        output.put_int(run.request.slices);
+        output.put(',');
+        output.put(strategy_to_cstr(run.request.strategy));
+        output.put(',');
+        output.put(run.success ? "SUCCESS" : "FAILED");
+        output.put(',');
+        output.put(csv_escape(run.error));
+        output.put(',');
 
         if (!run.success) {
-            output << ",,,,,,,,\n";
+            output.put(",,,,,,,,\n");
             continue;
         }
 
-        output << run.result.tca.filled_quantity << ','
-               << run.result.tca.target_quantity << ','
-               << format_double(run.result.tca.fill_rate) << ',';
-
-        if (run.result.tca.average_fill_price_ticks.has_value()) {
-            output << format_price(run.result.tca.average_fill_price_ticks.value());
+        const TcaSummary& tca = run.result.tca;
+        output.put_int(tca.filled_quantity);
+        output.put(',');
+        output.put_int(tca.target_quantity);
+        output.put(',');
+        output.put_fixed(tca.fill_rate, 6);
+        output.put(',');
+        if (tca.average_fill_price_ticks.has_value()) {
+            output.put_price(tca.average_fill_price_ticks.value());
         }
-        output << ','
-               << run.result.tca.arrival_benchmark_name << ',';
-
-        if (run.result.tca.arrival_benchmark_price_ticks.has_value()) {
-            output << format_price(run.result.tca.arrival_benchmark_price_ticks.value());
+        output.put(',');
+        output.put(tca.arrival_benchmark_name);
+        output.put(',');
+        if (tca.arrival_benchmark_price_ticks.has_value()) {
+            output.put_price(tca.arrival_benchmark_price_ticks.value());
         }
-        output << ',';
-
-        if (run.result.tca.implementation_shortfall_bps.has_value()) {
-            output << format_double(run.result.tca.implementation_shortfall_bps.value());
+        output.put(',');
+        if (tca.implementation_shortfall_bps.has_value()) {
+            output.put_fixed(tca.implementation_shortfall_bps.value(), 6);
         }
-        output << ','
-               << format_double(run.result.tca.participation_rate) << ','
-               << run.result.replay_stats.rows_processed << ','
-               << run.result.replay_stats.trades_generated << '\n';
+        output.put(',');
+        output.put_fixed(tca.participation_rate, 6);
+        output.put(',');
+        output.put_int(run.result.replay_stats.rows_processed);
+        output.put(',');
+        output.put_int(run.result.replay_stats.trades_generated);
+        output.put('\n');
     }
 
-    if (!output.good()) {
+    if (!output.close()) {
         out_error = "failed while writing runs output CSV: " + output_path;
         return false;
     }
@@ -1,108 +1,391 @@
 #include "csv_replay.h"
 
-#include <fstream>
-#include <iomanip>
+#include <glob.h>
+
+#include <algorithm>
+#include <deque>
+#include <queue>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "replay_binary.h"
 #include "replay_rows.h"
+#include "replay_trades.h"
 
 namespace {
 
-std::string format_price(PriceTicks ticks) {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(4) << ticks_to_price(ticks);
-    return oss.str();
-}
+// Holds back up to `window` rows so nearly sorted input comes out in replay order. A row
+// is released once `window` later rows have arrived, so a new row that sorts before the
+// last released one means the input was more disordered than the window allows.
+class ReorderWindow {
+public:
+    explicit ReorderWindow(std::size_t window) : window_(window) {}
 
-void append_replay_trades(std::uint64_t ts_ns,
-                          std::uint64_t seq,
-                          const std::vector<Trade>& trades,
-                          ReplayResult& replay) {
-    replay.stats.trades_generated += trades.size();
-    for (const auto& trade : trades) {
-        replay.trades.push_back(
-            {ts_ns, seq, trade.buy_order_id, trade.sell_order_id, trade.price_ticks, trade.quantity});
+    // Adds `row` and moves any row that is ready onto `out_ready`. Returns false, leaving
+    // the window unchanged, if `row` sorts before a row already released.
+    bool push(const ReplayRow& row, std::vector<ReplayRow>& out_ready) {
+        if (released_any_ && replay_row_before(row, last_released_)) {
+            return false;
+        }
+        if (pending_.empty() || !replay_row_before(row, pending_.back())) {
+            pending_.push_back(row);
+        } else {
+            pending_.insert(std::upper_bound(pending_.begin(), pending_.end(), row, replay_row_before), row);
+        }
+        if (pending_.size() > window_) {
+            release_front(out_ready);
+        }
+        return true;
+    }
+
+    void flush(std::vector<ReplayRow>& out_ready) {
+        while (!pending_.empty()) {
+            release_front(out_ready);
+        }
+    }
+
+private:
+    void release_front(std::vector<ReplayRow>& out_ready) {
+        last_released_ = pending_.front();
+        released_any_ = true;
+        out_ready.push_back(pending_.front());
+        pending_.pop_front();
+    }
+
+    std::size_t window_;
+    std::deque<ReplayRow> pending_;
+    ReplayRow last_released_;
+    bool released_any_ = false;
+};
+
+// One streamed input: a replay CSV or .merb file read a batch at a time and put into replay
+// order through its own reorder window. A binary already flagged sorted skips the window.
+class ReplayRowStream {
+public:
+    explicit ReplayRowStream(std::size_t reorder_window)
+        : reorder_window_(reorder_window), reorder_(reorder_window) {}
+
+    bool open(const std::string& path, std::string& out_error) {
+        path_ = path;
+        binary_input_ = is_replay_binary_file(path);
+        if (!binary_input_) {
+            return csv_.open(path, out_error);
+        }
+        if (!binary_.open(path, out_error)) {
+            return false;
+        }
+        reorder_ = ReorderWindow(binary_.sorted() ? 0 : reorder_window_);
+        return true;
+    }
+
+    const std::string& path() const { return path_; }
+
+    // Sets `out_row` to the next row in replay order, or clears `out_has_row` once the
+    // input is exhausted. Returns false on a malformed line or a row more out of order
+    // than the reorder window allows.
+    bool next(ReplayRow& out_row, bool& out_has_row, std::string& out_error) {
+        if (ready_pos_ == ready_.size() && !refill(out_error)) {
+            return false;
+        }
+        out_has_row = ready_pos_ < ready_.size();
+        if (out_has_row) {
+            out_row = ready_[ready_pos_++];
+        }
+        return true;
+    }
+
+private:
+    bool input_done() const {
+        return binary_input_ ? next_record_ >= binary_.size() : csv_.done();
+    }
+
+    bool read_batch(std::vector<ReplayRow>& rows, std::string& out_error) {
+        if (!binary_input_) {
+            return csv_.read(rows, kReplayBatchSize, out_error);
+        }
+        const std::size_t end = std::min(binary_.size(), next_record_ + kReplayBatchSize);
+        for (; next_record_ < end; ++next_record_) {
+            rows.push_back(binary_[next_record_]);
+        }
+        return true;
+    }
+
+    // Reads until at least one row leaves the window or the input ends.
+    bool refill(std::string& out_error) {
+        ready_.clear();
+        ready_pos_ = 0;
+        while (ready_.empty() && !flushed_) {
+            if (input_done()) {
+                reorder_.flush(ready_);
+                flushed_ = true;
+                break;
+            }
+            incoming_.clear();
+            if (!read_batch(incoming_, out_error)) {
+                return false;
+            }
+            for (const ReplayRow& row : incoming_) {
+                if (!reorder_.push(row, ready_)) {
+                    std::ostringstream oss;
+                    oss << "data row " << row.row_index + 1 << " is out of (ts_ns, seq) order by more than the "
+                        << "reorder window of " << reorder_window_ << " rows";
+                    out_error = oss.str();
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    std::string path_;
+    std::size_t reorder_window_;
+    ReorderWindow reorder_;
+    bool binary_input_ = false;
+    ReplayCsvReader csv_;
+    ReplayBinaryFile binary_;
+    std::size_t next_record_ = 0;
+    std::vector<ReplayRow> incoming_;
+    std::vector<ReplayRow> ready_;
+    std::size_t ready_pos_ = 0;
+    bool flushed_ = false;
+};
+
+// Next row of each stream, ordered for a min-heap on (ts_ns, seq, stream, row_index):
+// replay order across streams, with ties going to the earlier stream.
+struct MergeHead {
+    ReplayRow row;
+    std::size_t stream = 0;
+};
+
+struct MergeHeadAfter {
+    bool operator()(const MergeHead& lhs, const MergeHead& rhs) const {
+        if (lhs.row.ts_ns != rhs.row.ts_ns) {
+            return lhs.row.ts_ns > rhs.row.ts_ns;
+        }
+        if (lhs.row.seq != rhs.row.seq) {
+            return lhs.row.seq > rhs.row.seq;
+        }
+        if (lhs.stream != rhs.stream) {
+            return lhs.stream > rhs.stream;
+        }
+        return lhs.row.row_index > rhs.row.row_index;
+    }
+};
+
+// Replays the merge of `streams` through the engine in batches. Memory is one batch plus
+// each stream's buffers, however long the inputs are. Errors name the failing file when
+// there is more than one.
+template <typename OnAction>
+bool replay_merged_streams(MatchingEngine& engine,
+                           std::vector<ReplayRowStream>& streams,
+                           OnAction& on_action,
+                           std::string& out_error) {
+    std::vector<ReplayRow> batch;
+    batch.reserve(kReplayBatchSize);
+    ReplayBatchScratch scratch;
+    if (streams.size() == 1) {
+        // Nothing to merge: the stream's rows are already in replay order.
+        ReplayRow row;
+        bool has_row = true;
+        while (true) {
+            if (!streams[0].next(row, has_row, out_error)) {
+                return false;
+            }
+            if (!has_row) {
+                break;
+            }
+            batch.push_back(row);
+            if (batch.size() == kReplayBatchSize) {
+                apply_replay_rows(engine, batch, scratch, on_action);
+                batch.clear();
+            }
+        }
+        apply_replay_rows(engine, batch, scratch, on_action);
+        return true;
+    }
+
+    std::priority_queue<MergeHead, std::vector<MergeHead>, MergeHeadAfter> heads;
+    auto advance = [&](std::size_t stream) {
+        MergeHead head;
+        head.stream = stream;
+        bool has_row = false;
+        if (!streams[stream].next(head.row, has_row, out_error)) {
+            if (streams.size() > 1) {
+                out_error = streams[stream].path() + ": " + out_error;
+            }
+            return false;
+        }
+        if (has_row) {
+            heads.push(head);
+        }
+        return true;
+    };
+    for (std::size_t stream = 0; stream < streams.size(); ++stream) {
+        if (!advance(stream)) {
+            return false;
+        }
     }
+
+    while (!heads.empty()) {
+        const std::size_t stream = heads.top().stream;
+        batch.push_back(heads.top().row);
+        heads.pop();
+        if (batch.size() == kReplayBatchSize) {
+            apply_replay_rows(engine, batch, scratch, on_action);
+            batch.clear();
+        }
+        if (!advance(stream)) {
+            return false;
+        }
+    }
+    apply_replay_rows(engine, batch, scratch, on_action);
+    return true;
 }
 
+// on_action for apply_replay_rows that fills a ReplayResult, or hands trades to
+// `trade_writer` when one is given.
+class ReplayRecorder {
+public:
+    ReplayRecorder(ReplayResult& result, ReplayTradeWriter* trade_writer)
+        : result_(result), trade_writer_(trade_writer) {}
+
+    void operator()(const ReplayRow& row, const ActionResult& result, const Trade* trades) {
+        ReplayStats& stats = result_.stats;
+        ++stats.rows_processed;
+        if (result.accepted) {
+            ++stats.accepted_actions;
+        } else {
+            ++stats.rejected_actions;
+        }
+        if (row.action == ReplayAction::CANCEL) {
+            if (result.accepted) {
+                ++stats.cancel_success;
+            } else {
+                ++stats.cancel_not_found;
+            }
+        }
+
+        stats.trades_generated += result.trade_count;
+        for (std::size_t t = 0; t < result.trade_count; ++t) {
+            const Trade& trade = trades[t];
+            const ReplayTradeRecord record{row.ts_ns,          row.seq,           trade.buy_order_id,
+                                           trade.sell_order_id, trade.price_ticks, trade.quantity};
+            if (trade_writer_ != nullptr) {
+                trade_writer_->write(record);
+            } else {
+                result_.trades.push_back(record);
+            }
+        }
+    }
+
+private:
+    ReplayResult& result_;
+    ReplayTradeWriter* trade_writer_;
+};
+
 }  // namespace
 
+EngineAction to_engine_action(const ReplayRow& row) {
+    EngineAction action;
+    action.order = {row.order_id, row.side, row.price_ticks, row.quantity, row.tif, row.type};
+    if (row.action == ReplayAction::CANCEL) {
+        action.type = EngineActionType::CANCEL;
+    } else if (row.action == ReplayAction::REPLACE) {
+        action.type = EngineActionType::REPLACE;
+        action.new_price_ticks = row.price_ticks;
+        action.new_quantity = row.quantity;
+    }
+    return action;
+}
+
 bool replay_csv_file(const std::string& csv_path,
                      MatchingEngine& engine,
                      ReplayResult& out_result,
-                     std::string& out_error) {
+                     std::string& out_error,
+                     const ReplayOptions& options) {
     out_result = ReplayResult{};
 
+    ReplayRecorder record(out_result, options.trade_writer);
+
+    if (is_replay_binary_file(csv_path)) {
+        ReplayBinaryFile binary;
+        if (!binary.open(csv_path, out_error)) {
+            return false;
+        }
+        if (binary.sorted()) {
+            apply_replay_rows(engine, binary, record);
+            return true;
+        }
+    }
+    if (options.streaming) {
+        std::vector<ReplayRowStream> streams;
+        streams.emplace_back(options.reorder_window);
+        if (!streams.back().open(csv_path, out_error)) {
+            return false;
+        }
+        return replay_merged_streams(engine, streams, record, out_error);
+    }
+
     std::vector<ReplayRow> rows;
-    if (!parse_replay_csv_rows(csv_path, rows, out_error)) {
+    if (!load_replay_rows(csv_path, rows, out_error)) {
         return false;
     }
-    sort_replay_rows(rows);
+    apply_replay_rows(engine, rows, record);
+    return true;
+}
 
-    for (const auto& row : rows) {
-        ++out_result.stats.rows_processed;
+bool replay_csv_files(const std::vector<std::string>& paths,
+                      MatchingEngine& engine,
+                      ReplayResult& out_result,
+                      std::string& out_error,
+                      const ReplayOptions& options) {
+    out_result = ReplayResult{};
 
-        if (row.action == ReplayAction::NEW) {
-            SubmitResult result = engine.submit(
-                {row.order_id, row.side, row.price_ticks, row.quantity, row.tif, row.type});
-            if (result.accepted) {
-                ++out_result.stats.accepted_actions;
-            } else {
-                ++out_result.stats.rejected_actions;
-            }
-            append_replay_trades(row.ts_ns, row.seq, result.trades, out_result);
-            continue;
+    std::vector<ReplayRowStream> streams;
+    streams.reserve(paths.size());
+    for (const std::string& path : paths) {
+        streams.emplace_back(options.reorder_window);
+        if (!streams.back().open(path, out_error)) {
+            return false;
         }
+    }
+    ReplayRecorder record(out_result, options.trade_writer);
+    return replay_merged_streams(engine, streams, record, out_error);
+}
 
-        if (row.action == ReplayAction::CANCEL) {
-            if (engine.cancel(row.order_id)) {
-                ++out_result.stats.accepted_actions;
-                ++out_result.stats.cancel_success;
-            } else {
-                ++out_result.stats.rejected_actions;
-                ++out_result.stats.cancel_not_found;
-            }
+bool expand_replay_paths(const std::vector<std::string>& patterns,
+                         std::vector<std::string>& out_paths,
+                         std::string& out_error) {
+    out_paths.clear();
+    for (const std::string& pattern : patterns) {
+        if (pattern.find_first_of("*?[") == std::string::npos) {
+            out_paths.push_back(pattern);
             continue;
         }
-
-        SubmitResult result = engine.replace(row.order_id, row.new_price_ticks, row.new_quantity);
-        if (result.accepted) {
-            ++out_result.stats.accepted_actions;
-        } else {
-            ++out_result.stats.rejected_actions;
+        glob_t matches{};
+        const int status = glob(pattern.c_str(), 0, nullptr, &matches);
+        if (status == 0) {
+            out_paths.insert(out_paths.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+        }
+        globfree(&matches);
+        if (status != 0) {
+            out_error = "no replay files match: " + pattern;
+            return false;
         }
-        append_replay_trades(row.ts_ns, row.seq, result.trades, out_result);
     }
-
     return true;
 }
 
 bool write_replay_trades_csv(const std::string& csv_path,
                              const std::vector<ReplayTradeRecord>& trades,
                              std::string& out_error) {
-    std::ofstream output(csv_path);
-    if (!output.is_open()) {
-        out_error = "failed to open output CSV for writing: " + csv_path;
+    ReplayTradeWriter output;
+    if (!output.open(csv_path, TradeOutputFormat::CSV, out_error)) {
         return false;
     }
-
-    output << "ts_ns,seq,buy_order_id,sell_order_id,price_ticks,price,quantity\n";
     for (const auto& trade : trades) {
-        output << trade.ts_ns << ','
-               << trade.seq << ','
-               << trade.buy_order_id << ','
-               << trade.sell_order_id << ','
-               << trade.price_ticks << ','
-               << format_price(trade.price_ticks) << ','
-               << trade.quantity << '\n';
-    }
-
-    if (!output.good()) {
-        out_error = "failed while writing output CSV: " + csv_path;
-        return false;
+        output.write(trade);
     }
-
-    return true;
+    return output.close(out_error);
 }
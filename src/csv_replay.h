@@ -1,11 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
 
 #include "matching_engine.h"
+#include "replay_rows.h"
 
 struct ReplayStats {
     std::size_t rows_processed = 0;
@@ -27,13 +29,96 @@ struct ReplayTradeRecord {
 
 struct ReplayResult {
     ReplayStats stats;
+    // Every fill in replay order, unless ReplayOptions::trade_writer takes them instead.
     std::vector<ReplayTradeRecord> trades;
 };
 
+class ReplayTradeWriter;
+
+EngineAction to_engine_action(const ReplayRow& row);
+
+constexpr std::size_t kReplayBatchSize = 1024;
+
+// Buffers apply_replay_rows hands to process_batch(). A caller that applies many small
+// batches keeps one of these so the buffers are allocated once, not once per batch.
+struct ReplayBatchScratch {
+    std::vector<EngineAction> actions;
+    std::vector<ActionResult> results;
+    std::vector<Trade> trades;
+};
+
+// Feeds `rows` (any indexable sequence of ReplayRow, such as a vector or a ReplayBinaryFile)
+// to the engine through process_batch() in chunks of kReplayBatchSize and calls
+// on_action(row, result, trades) for every row in order, where `trades` points at that
+// row's result.trade_count trades.
+template <typename Rows, typename OnAction>
+void apply_replay_rows(MatchingEngine& engine, const Rows& rows, ReplayBatchScratch& scratch, OnAction&& on_action) {
+    const std::size_t batch_size = std::min(rows.size(), kReplayBatchSize);
+    if (scratch.actions.size() < batch_size) {
+        scratch.actions.resize(batch_size);
+        scratch.results.resize(batch_size);
+    }
+
+    for (std::size_t begin = 0; begin < rows.size(); begin += kReplayBatchSize) {
+        const std::size_t count = std::min(kReplayBatchSize, rows.size() - begin);
+        for (std::size_t i = 0; i < count; ++i) {
+            scratch.actions[i] = to_engine_action(rows[begin + i]);
+        }
+        scratch.trades.clear();
+        engine.process_batch(scratch.actions.data(), count, scratch.results.data(), scratch.trades);
+        for (std::size_t i = 0; i < count; ++i) {
+            const ActionResult& result = scratch.results[i];
+            on_action(rows[begin + i], result, scratch.trades.data() + result.first_trade);
+        }
+    }
+}
+
+template <typename Rows, typename OnAction>
+void apply_replay_rows(MatchingEngine& engine, const Rows& rows, OnAction&& on_action) {
+    ReplayBatchScratch scratch;
+    apply_replay_rows(engine, rows, scratch, on_action);
+}
+
+struct ReplayOptions {
+    // Feed rows to the engine as they are read instead of loading and sorting the whole
+    // file first. Memory then stays bounded by the reorder window.
+    bool streaming = false;
+    // Streaming only: how many rows may be held back to restore replay order in nearly
+    // sorted input (0 requires sorted input). A row that sorts before one already replayed
+    // fails the replay.
+    std::size_t reorder_window = 4096;
+    // When set, each trade goes to this open writer as it is produced and
+    // ReplayResult::trades stays empty, so memory does not grow with the fill count.
+    // stats.trades_generated counts the same either way.
+    ReplayTradeWriter* trade_writer = nullptr;
+};
+
+// Replays a replay CSV or a .merb binary (detected by its magic); binaries written in
+// replay order are read straight from the mapping. When it succeeds, streaming gives the
+// same results as the default full sort; on a malformed line it stops partway instead of
+// before the first row.
 bool replay_csv_file(const std::string& csv_path,
                      MatchingEngine& engine,
                      ReplayResult& out_result,
-                     std::string& out_error);
+                     std::string& out_error,
+                     const ReplayOptions& options = {});
+
+// Replays several replay CSV or .merb files as one stream. Each file is read separately
+// through its own reorder window (options.reorder_window; options.streaming is implied) and
+// the files are merged on (ts_ns, seq, file position in `paths`, row_index), so memory grows
+// with the number of files rather than their rows. Errors are prefixed with the file's path
+// when there is more than one file.
+bool replay_csv_files(const std::vector<std::string>& paths,
+                      MatchingEngine& engine,
+                      ReplayResult& out_result,
+                      std::string& out_error,
+                      const ReplayOptions& options = {});
+
+// Expands each pattern containing *, ? or [ to its matching paths in sorted order; other
+// entries are kept as given. A pattern with no matches is an error.
+bool expand_replay_paths(const std::vector<std::string>& patterns,
+                         std::vector<std::string>& out_paths,
+                         std::string& out_error);
 
 bool write_replay_trades_csv(const std::string& csv_path,
                              const std::vector<ReplayTradeRecord>& trades,
@@ -0,0 +1,210 @@
+#include "csv_scan.h"
+
+#include <cassert>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MATCHING_ENGINE_CSV_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Stores the comma at `offset` if there is room and counts it either way.
+inline void record_comma(CsvLineScan& scan, std::uint32_t* comma_offsets, std::size_t max_commas, std::size_t offset) {
+    if (scan.comma_count < max_commas) {
+        comma_offsets[scan.comma_count] = static_cast<std::uint32_t>(offset);
+    }
+    ++scan.comma_count;
+}
+
+// Finishes a line from `p` byte by byte; also the tail of the vector kernels.
+CsvLineScan scan_tail(const char* begin,
+                      const char* p,
+                      const char* end,
+                      std::uint32_t* comma_offsets,
+                      std::size_t max_commas,
+                      CsvLineScan scan) {
+    for (; p < end; ++p) {
+        const char ch = *p;
+        if (ch == '\n') {
+            break;
+        }
+        if (ch == ',') {
+            record_comma(scan, comma_offsets, max_commas, static_cast<std::size_t>(p - begin));
+        } else if (ch == '"') {
+            scan.has_quote = true;
+        }
+    }
+    scan.length = static_cast<std::size_t>(p - begin);
+    return scan;
+}
+
+CsvLineScan scan_scalar(const char* begin, const char* end, std::uint32_t* comma_offsets, std::size_t max_commas) {
+    return scan_tail(begin, begin, end, comma_offsets, max_commas, CsvLineScan{});
+}
+
+#ifdef MATCHING_ENGINE_CSV_SCAN_X86
+
+// Consumes one block's masks. Returns true once the block held the line's newline.
+inline bool consume_block(const char* begin,
+                          const char* block,
+                          std::uint32_t newline_mask,
+                          std::uint32_t comma_mask,
+                          std::uint32_t quote_mask,
+                          std::uint32_t* comma_offsets,
+                          std::size_t max_commas,
+                          CsvLineScan& scan) {
+    std::uint32_t before_newline = ~std::uint32_t{0};
+    if (newline_mask != 0) {
+        before_newline = (std::uint32_t{1} << __builtin_ctz(newline_mask)) - 1;
+    }
+    comma_mask &= before_newline;
+    scan.has_quote |= (quote_mask & before_newline) != 0;
+
+    const std::size_t base = static_cast<std::size_t>(block - begin);
+    while (comma_mask != 0) {
+        record_comma(scan, comma_offsets, max_commas, base + static_cast<std::size_t>(__builtin_ctz(comma_mask)));
+        comma_mask &= comma_mask - 1;
+    }
+
+    if (newline_mask != 0) {
+        scan.length = base + static_cast<std::size_t>(__builtin_ctz(newline_mask));
+        return true;
+    }
+    return false;
+}
+
+__attribute__((target("sse2")))
+CsvLineScan scan_sse2(const char* begin, const char* end, std::uint32_t* comma_offsets, std::size_t max_commas) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i quote = _mm_set1_epi8('"');
+
+    CsvLineScan scan;
+    const char* p = begin;
+    for (; end - p >= 16; p += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto newline_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+        const auto comma_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, comma)));
+        const auto quote_mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, quote)));
+        if (consume_block(begin, p, newline_mask, comma_mask, quote_mask, comma_offsets, max_commas, scan)) {
+            return scan;
+        }
+    }
+    return scan_tail(begin, p, end, comma_offsets, max_commas, scan);
+}
+
+__attribute__((target("avx2")))
+CsvLineScan scan_avx2(const char* begin, const char* end, std::uint32_t* comma_offsets, std::size_t max_commas) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i quote = _mm256_set1_epi8('"');
+
+    CsvLineScan scan;
+    const char* p = begin;
+    for (; end - p >= 32; p += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const auto newline_mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+        const auto comma_mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, comma)));
+        const auto quote_mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, quote)));
+        if (consume_block(begin, p, newline_mask, comma_mask, quote_mask, comma_offsets, max_commas, scan)) {
+            return scan;
+        }
+    }
+    // A short tail still gets one 16-byte step before going byte by byte.
+    if (end - p >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto newline_mask = static_cast<std::uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm256_castsi256_si128(newline))));
+        const auto comma_mask = static_cast<std::uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm256_castsi256_si128(comma))));
+        const auto quote_mask = static_cast<std::uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm256_castsi256_si128(quote))));
+        if (consume_block(begin, p, newline_mask, comma_mask, quote_mask, comma_offsets, max_commas, scan)) {
+            return scan;
+        }
+        p += 16;
+    }
+    return scan_tail(begin, p, end, comma_offsets, max_commas, scan);
+}
+
+#endif
+
+using ScanFn = CsvLineScan (*)(const char*, const char*, std::uint32_t*, std::size_t);
+
+ScanFn kernel_fn(CsvScanKernel kernel) {
+    switch (kernel) {
+#ifdef MATCHING_ENGINE_CSV_SCAN_X86
+        case CsvScanKernel::AVX2:
+            return scan_avx2;
+        case CsvScanKernel::SSE2:
+            return scan_sse2;
+#endif
+        default:
+            return scan_scalar;
+    }
+}
+
+CsvScanKernel detect_best_kernel() {
+#ifdef MATCHING_ENGINE_CSV_SCAN_X86
+    __builtin_cpu_init();
+#endif
+    if (csv_scan_kernel_supported(CsvScanKernel::AVX2)) {
+        return CsvScanKernel::AVX2;
+    }
+    if (csv_scan_kernel_supported(CsvScanKernel::SSE2)) {
+        return CsvScanKernel::SSE2;
+    }
+    return CsvScanKernel::SCALAR;
+}
+
+}  // namespace
+
+bool csv_scan_kernel_supported(CsvScanKernel kernel) {
+    switch (kernel) {
+        case CsvScanKernel::SCALAR:
+            return true;
+#ifdef MATCHING_ENGINE_CSV_SCAN_X86
+        case CsvScanKernel::SSE2:
+            return __builtin_cpu_supports("sse2");
+        case CsvScanKernel::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+CsvScanKernel best_csv_scan_kernel() {
+    static const CsvScanKernel best = detect_best_kernel();
+    return best;
+}
+
+const char* csv_scan_kernel_name(CsvScanKernel kernel) {
+    switch (kernel) {
+        case CsvScanKernel::SCALAR:
+            return "scalar";
+        case CsvScanKernel::SSE2:
+            return "sse2";
+        case CsvScanKernel::AVX2:
+            return "avx2";
+    }
+    return "unknown";
+}
+
+CsvLineScan scan_csv_line(const char* begin,
+                          const char* end,
+                          std::uint32_t* comma_offsets,
+                          std::size_t max_commas) {
+    static const ScanFn best = kernel_fn(best_csv_scan_kernel());
+    return best(begin, end, comma_offsets, max_commas);
+}
+
+CsvLineScan scan_csv_line(CsvScanKernel kernel,
+                          const char* begin,
+                          const char* end,
+                          std::uint32_t* comma_offsets,
+                          std::size_t max_commas) {
+    assert(csv_scan_kernel_supported(kernel));
+    return kernel_fn(kernel)(begin, end, comma_offsets, max_commas);
+}
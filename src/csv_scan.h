@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Structural-character scan for CSV ingestion: one pass over a line finds its end ('\n'),
+// the offsets of its commas, and whether it contains a quote (quoted lines are left to
+// the caller's unescaping path). Vector kernels are chosen once at runtime.
+enum class CsvScanKernel { SCALAR, SSE2, AVX2 };
+
+struct CsvLineScan {
+    // Bytes before the newline (or before `end` when the last line has none).
+    std::size_t length = 0;
+    // Commas before the newline; only the first `max_commas` offsets are stored.
+    std::size_t comma_count = 0;
+    bool has_quote = false;
+};
+
+bool csv_scan_kernel_supported(CsvScanKernel kernel);
+// The widest supported kernel on this CPU.
+CsvScanKernel best_csv_scan_kernel();
+const char* csv_scan_kernel_name(CsvScanKernel kernel);
+
+// Scans [begin, end) up to the first '\n' with the best kernel.
+CsvLineScan scan_csv_line(const char* begin,
+                          const char* end,
+                          std::uint32_t* comma_offsets,
+                          std::size_t max_commas);
+// Same, with an explicit kernel; it must be supported.
+CsvLineScan scan_csv_line(CsvScanKernel kernel,
+                          const char* begin,
+                          const char* end,
+                          std::uint32_t* comma_offsets,
+                          std::size_t max_commas);
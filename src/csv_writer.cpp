@@ -0,0 +1,96 @@
+#include "csv_writer.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+static_assert(kTicksPerUnit == 10000, "put_price prints four decimals");
+
+// Below this magnitude ticks_to_price() is within a quarter tick of the exact price, so the
+// stream's rounding to four decimals always lands on the exact integer result.
+constexpr std::uint64_t kExactPriceTicks = 1000000000000000ULL;
+
+}  // namespace
+
+CsvWriter::~CsvWriter() {
+    close();
+}
+
+bool CsvWriter::open(const std::string& path) {
+    close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (file_ == nullptr) {
+        return false;
+    }
+    if (!buffer_) {
+        buffer_.reset(new char[kBufferBytes]);
+    }
+    cursor_ = buffer_.get();
+    end_ = cursor_ + kBufferBytes;
+    ok_ = true;
+    return true;
+}
+
+bool CsvWriter::close() {
+    if (file_ == nullptr) {
+        return ok_;
+    }
+    flush();
+    ok_ = std::fclose(file_) == 0 && ok_;
+    file_ = nullptr;
+    cursor_ = nullptr;
+    end_ = nullptr;
+    return ok_;
+}
+
+void CsvWriter::flush() {
+    assert(file_ != nullptr);
+    const auto bytes = static_cast<std::size_t>(cursor_ - buffer_.get());
+    if (bytes != 0 && std::fwrite(buffer_.get(), 1, bytes, file_) != bytes) {
+        ok_ = false;
+    }
+    cursor_ = buffer_.get();
+}
+
+void CsvWriter::put(std::string_view text) {
+    if (text.size() > kBufferBytes / 2) {
+        flush();
+        if (std::fwrite(text.data(), 1, text.size(), file_) != text.size()) {
+            ok_ = false;
+        }
+        return;
+    }
+    reserve(text.size());
+    std::memcpy(cursor_, text.data(), text.size());
+    cursor_ += text.size();
+}
+
+void CsvWriter::put_price(PriceTicks ticks) {
+    const std::uint64_t magnitude =
+        ticks < 0 ? 0 - static_cast<std::uint64_t>(ticks) : static_cast<std::uint64_t>(ticks);
+    if (magnitude >= kExactPriceTicks) {
+        put_fixed(ticks_to_price(ticks), 4);
+        return;
+    }
+
+    reserve(kMaxIntChars);
+    if (ticks < 0) {
+        *cursor_++ = '-';
+    }
+    cursor_ = std::to_chars(cursor_, end_, magnitude / kTicksPerUnit).ptr;
+    auto fraction = static_cast<unsigned>(magnitude % kTicksPerUnit);
+    cursor_[0] = '.';
+    for (int digit = 4; digit >= 1; --digit) {
+        cursor_[digit] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    cursor_ += 5;
+}
+
+void CsvWriter::put_fixed(double value, int decimals) {
+    assert(decimals >= 0 && decimals <= 32);
+    reserve(kMaxFixedChars);
+    cursor_ = std::to_chars(cursor_, end_, value, std::chars_format::fixed, decimals).ptr;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "types.h"
+
+// Buffered CSV output: fields are formatted with std::to_chars straight into one reusable
+// buffer, which goes to the file in large blocks. Numbers print exactly as std::ostream
+// prints them, so files are byte-identical to ones written with operator<<.
+class CsvWriter {
+public:
+    CsvWriter() = default;
+    ~CsvWriter();
+
+    CsvWriter(const CsvWriter&) = delete;
+    CsvWriter& operator=(const CsvWriter&) = delete;
+
+    // Creates or truncates `path`.
+    bool open(const std::string& path);
+    // Writes out what is buffered and closes the file. Returns false if any write failed.
+    bool close();
+
+    void put(char ch) {
+        reserve(1);
+        *cursor_++ = ch;
+    }
+
+    void put(std::string_view text);
+
+    template <typename Int>
+    void put_int(Int value) {
+        reserve(kMaxIntChars);
+        cursor_ = std::to_chars(cursor_, end_, value).ptr;
+    }
+
+    // `ticks` as a price with four decimals, as std::fixed << std::setprecision(4) prints
+    // ticks_to_price(ticks).
+    void put_price(PriceTicks ticks);
+
+    // `value` with `decimals` digits after the point, as std::fixed << std::setprecision()
+    // prints it.
+    void put_fixed(double value, int decimals);
+
+private:
+    static constexpr std::size_t kBufferBytes = std::size_t{1} << 20;
+    static constexpr std::size_t kMaxIntChars = 24;
+    // Sign, 309 integer digits of the largest double, point and up to 32 decimals.
+    static constexpr std::size_t kMaxFixedChars = 344;
+
+    void reserve(std::size_t bytes) {
+        if (static_cast<std::size_t>(end_ - cursor_) < bytes) {
+            flush();
+        }
+    }
+
+    void flush();
+
+    std::FILE* file_ = nullptr;
+    std::unique_ptr<char[]> buffer_;
+    char* cursor_ = nullptr;
+    char* end_ = nullptr;
+    bool ok_ = true;
+};
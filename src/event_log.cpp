@@ -0,0 +1,139 @@
+#include "event_log.h"
+
+#include <type_traits>
+#include <utility>
+
+static_assert(std::is_trivially_copyable_v<BookEvent>, "Spill segments store raw BookEvent records");
+
+EventLog::EventLog(std::size_t capacity) : capacity_(capacity) {
+    events_.reserve(capacity_);
+}
+
+EventLog::~EventLog() {
+    close_spill();
+}
+
+EventLog::EventLog(EventLog&& other) noexcept
+    : capacity_(other.capacity_),
+      events_(std::move(other.events_)),
+      head_(other.head_),
+      size_(other.size_),
+      evicted_count_(other.evicted_count_),
+      spill_(std::exchange(other.spill_, nullptr)),
+      spill_path_(std::move(other.spill_path_)),
+      spill_failed_(other.spill_failed_) {}
+
+EventLog& EventLog::operator=(EventLog&& other) noexcept {
+    if (this != &other) {
+        close_spill();
+        capacity_ = other.capacity_;
+        events_ = std::move(other.events_);
+        head_ = other.head_;
+        size_ = other.size_;
+        evicted_count_ = other.evicted_count_;
+        spill_ = std::exchange(other.spill_, nullptr);
+        spill_path_ = std::move(other.spill_path_);
+        spill_failed_ = other.spill_failed_;
+    }
+    return *this;
+}
+
+bool EventLog::spill_to(const std::string& path, std::string& out_error) {
+    close_spill();
+    spill_failed_ = false;
+    spill_ = std::fopen(path.c_str(), "wb");
+    if (spill_ == nullptr) {
+        out_error = "failed to open event spill segment for writing: " + path;
+        return false;
+    }
+    spill_path_ = path;
+    return true;
+}
+
+bool EventLog::flush_spill(std::string& out_error) {
+    if (spill_ != nullptr && std::fflush(spill_) != 0) {
+        spill_failed_ = true;
+    }
+    if (spill_failed_) {
+        out_error = "failed while writing event spill segment: " + spill_path_;
+        return false;
+    }
+    return true;
+}
+
+void EventLog::append(const BookEvent& event) {
+    if (capacity_ == 0 || size_ < capacity_) {
+        events_.push_back(event);
+        ++size_;
+        return;
+    }
+
+    // Full ring: the oldest event makes room for the newest.
+    BookEvent& oldest = events_[head_];
+    if (spill_ != nullptr && std::fwrite(&oldest, sizeof(BookEvent), 1, spill_) != 1) {
+        spill_failed_ = true;
+    }
+    oldest = event;
+    head_ = head_ + 1 == events_.size() ? 0 : head_ + 1;
+    ++evicted_count_;
+}
+
+EventLog::Range EventLog::since(std::uint64_t seq_num) const {
+    if (size_ == 0) {
+        return {};
+    }
+
+    const std::uint64_t first_seq = (*this)[0].seq_num;
+    if (seq_num < first_seq) {
+        return all();
+    }
+    const std::uint64_t skip = seq_num - first_seq + 1;
+    if (skip >= size_) {
+        return {};
+    }
+    return slice(static_cast<std::size_t>(skip), size_ - static_cast<std::size_t>(skip));
+}
+
+EventLog::Range EventLog::slice(std::size_t first, std::size_t count) const {
+    if (count == 0) {
+        return {};
+    }
+
+    const std::size_t start = physical(first);
+    const std::size_t contiguous = events_.size() - start;
+    if (count <= contiguous) {
+        return Range(events_.data() + start, count, nullptr, 0);
+    }
+    return Range(events_.data() + start, contiguous, events_.data(), count - contiguous);
+}
+
+void EventLog::close_spill() {
+    if (spill_ != nullptr) {
+        if (std::fclose(spill_) != 0) {
+            spill_failed_ = true;
+        }
+        spill_ = nullptr;
+    }
+}
+
+bool load_event_spill(const std::string& path, std::vector<BookEvent>& out_events, std::string& out_error) {
+    out_events.clear();
+    std::FILE* input = std::fopen(path.c_str(), "rb");
+    if (input == nullptr) {
+        out_error = "failed to open event spill segment: " + path;
+        return false;
+    }
+
+    BookEvent event;
+    std::size_t bytes_read = 0;
+    while ((bytes_read = std::fread(&event, 1, sizeof(BookEvent), input)) == sizeof(BookEvent)) {
+        out_events.push_back(event);
+    }
+    const bool truncated = bytes_read != 0 || std::ferror(input) != 0;
+    std::fclose(input);
+    if (truncated) {
+        out_error = "event spill segment is truncated or unreadable: " + path;
+        return false;
+    }
+    return true;
+}
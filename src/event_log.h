@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+// Sequenced book-event log. With a capacity it is a ring buffer that keeps the newest
+// `capacity` events; with capacity 0 it keeps every event. Sequence numbers are
+// contiguous, so the position of any retained seq_num is computed rather than searched.
+//
+// Evicted events can optionally be appended to a spill segment on disk (raw BookEvent
+// records) and read back with load_event_spill().
+class EventLog {
+public:
+    // Zero-copy view of a run of retained events, oldest first. The run may wrap around
+    // the ring, so it is stored as up to two contiguous segments. Invalidated by the next
+    // append.
+    class Range {
+    public:
+        class const_iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = BookEvent;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const BookEvent*;
+            using reference = const BookEvent&;
+
+            const_iterator() = default;
+            // Copies the range's segments, so the iterator outlives a temporary Range.
+            const_iterator(const Range& range, std::size_t index)
+                : head_(range.head_), head_size_(range.head_size_), tail_(range.tail_), index_(index) {}
+
+            reference operator*() const { return at(index_); }
+            pointer operator->() const { return &at(index_); }
+            reference operator[](difference_type offset) const { return at(index_ + offset); }
+
+            const_iterator& operator++() {
+                ++index_;
+                return *this;
+            }
+            const_iterator operator++(int) {
+                const_iterator previous = *this;
+                ++index_;
+                return previous;
+            }
+            const_iterator& operator--() {
+                --index_;
+                return *this;
+            }
+            const_iterator operator--(int) {
+                const_iterator previous = *this;
+                --index_;
+                return previous;
+            }
+            const_iterator& operator+=(difference_type offset) {
+                index_ += offset;
+                return *this;
+            }
+            const_iterator& operator-=(difference_type offset) {
+                index_ -= offset;
+                return *this;
+            }
+            friend const_iterator operator+(const_iterator it, difference_type offset) { return it += offset; }
+            friend const_iterator operator-(const_iterator it, difference_type offset) { return it -= offset; }
+            friend difference_type operator-(const const_iterator& lhs, const const_iterator& rhs) {
+                return static_cast<difference_type>(lhs.index_) - static_cast<difference_type>(rhs.index_);
+            }
+            friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) {
+                return lhs.index_ == rhs.index_;
+            }
+            friend bool operator!=(const const_iterator& lhs, const const_iterator& rhs) {
+                return lhs.index_ != rhs.index_;
+            }
+            friend bool operator<(const const_iterator& lhs, const const_iterator& rhs) {
+                return lhs.index_ < rhs.index_;
+            }
+
+        private:
+            reference at(std::size_t index) const {
+                return index < head_size_ ? head_[index] : tail_[index - head_size_];
+            }
+
+            const BookEvent* head_ = nullptr;
+            std::size_t head_size_ = 0;
+            const BookEvent* tail_ = nullptr;
+            std::size_t index_ = 0;
+        };
+
+        Range() = default;
+        Range(const BookEvent* head, std::size_t head_size, const BookEvent* tail, std::size_t tail_size)
+            : head_(head), head_size_(head_size), tail_(tail), tail_size_(tail_size) {}
+
+        std::size_t size() const { return head_size_ + tail_size_; }
+        bool empty() const { return size() == 0; }
+        const BookEvent& operator[](std::size_t index) const {
+            return index < head_size_ ? head_[index] : tail_[index - head_size_];
+        }
+        const BookEvent& front() const { return (*this)[0]; }
+        const BookEvent& back() const { return (*this)[size() - 1]; }
+
+        const_iterator begin() const { return const_iterator(*this, 0); }
+        const_iterator end() const { return const_iterator(*this, size()); }
+
+    private:
+        const BookEvent* head_ = nullptr;
+        std::size_t head_size_ = 0;
+        const BookEvent* tail_ = nullptr;
+        std::size_t tail_size_ = 0;
+    };
+
+    explicit EventLog(std::size_t capacity = 0);
+    ~EventLog();
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+    EventLog(EventLog&& other) noexcept;
+    EventLog& operator=(EventLog&& other) noexcept;
+
+    // Starts appending evicted events to `path` (truncating it). Only meaningful for a
+    // bounded log; an unbounded log never evicts.
+    bool spill_to(const std::string& path, std::string& out_error);
+    // Flushes the spill segment. Returns false if any spill write since spill_to() failed,
+    // in which case the segment is missing events.
+    bool flush_spill(std::string& out_error);
+
+    void append(const BookEvent& event);
+
+    // Events with seq_num > `seq_num` that are still retained.
+    Range since(std::uint64_t seq_num) const;
+    Range all() const { return slice(0, size_); }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    std::size_t capacity() const { return capacity_; }
+    const BookEvent& operator[](std::size_t index) const { return events_[physical(index)]; }
+
+    // Total number of events ever dropped from (or spilled out of) the ring.
+    std::uint64_t evicted_count() const { return evicted_count_; }
+    bool spilling() const { return spill_ != nullptr; }
+    // True once a spill write has failed; stays set until the next spill_to().
+    bool spill_failed() const { return spill_failed_; }
+
+private:
+    std::size_t physical(std::size_t index) const {
+        const std::size_t slot = head_ + index;
+        return slot < events_.size() ? slot : slot - events_.size();
+    }
+    Range slice(std::size_t first, std::size_t count) const;
+    void close_spill();
+
+    std::size_t capacity_;
+    std::vector<BookEvent> events_;
+    // Physical slot of the oldest retained event.
+    std::size_t head_ = 0;
+    std::size_t size_ = 0;
+    std::uint64_t evicted_count_ = 0;
+    std::FILE* spill_ = nullptr;
+    std::string spill_path_;
+    bool spill_failed_ = false;
+};
+
+// Reads back a spill segment written by EventLog::spill_to().
+bool load_event_spill(const std::string& path, std::vector<BookEvent>& out_events, std::string& out_error);
@@ -10,6 +10,7 @@
 #include <numeric>
 #include <utility>
 
+#include "replay_binary.h"
 #include "replay_rows.h"
 
 namespace {
@@ -71,56 +72,61 @@ std::optional<PriceTicks> capture_arrival_benchmark(const MatchingEngine& engine
     return std::nullopt;
 }
 
-void append_market_trades(const ReplayRow& row,
-                          const std::vector<Trade>& trades,
-                          BacktestResult& backtest,
-                          std::uint64_t& market_traded_quantity) {
-    backtest.replay_stats.trades_generated += trades.size();
-    for (const auto& trade : trades) {
-        backtest.market_trades.push_back(
-            {row.ts_ns, row.seq, trade.buy_order_id, trade.sell_order_id, trade.price_ticks, trade.quantity});
-        market_traded_quantity += static_cast<std::uint64_t>(trade.quantity);
-    }
+// Backtests only read trades and book state, so they skip event capture entirely.
+EngineConfig untracked_engine_config() {
+    EngineConfig config;
+    config.event_log_mode = EventLogMode::OFF;
+    return config;
 }
 
-int fill_quantity_from_child_trades(const std::vector<Trade>& trades, Side side, int child_order_id) {
-    int filled = 0;
-    for (const auto& trade : trades) {
-        const bool involved =
-            side == Side::BUY ? (trade.buy_order_id == child_order_id)
-                              : (trade.sell_order_id == child_order_id);
-        if (involved) {
-            filled += trade.quantity;
-        }
+// Records each market trade as the engine emits it, instead of collecting a per-row vector.
+class MarketTradeRecorder {
+public:
+    MarketTradeRecorder(const ReplayRow& row, BacktestResult& backtest, std::uint64_t& market_traded_quantity)
+        : row_(row), backtest_(backtest), market_traded_quantity_(market_traded_quantity) {}
+
+    void operator()(const Trade& trade) {
+        ++backtest_.replay_stats.trades_generated;
+        backtest_.market_trades.push_back(
+            {row_.ts_ns, row_.seq, trade.buy_order_id, trade.sell_order_id, trade.price_ticks, trade.quantity});
+        market_traded_quantity_ += static_cast<std::uint64_t>(trade.quantity);
     }
-    return filled;
-}
 
-std::optional<PriceTicks> average_fill_price_from_child_trades(const std::vector<Trade>& trades,
-                                                               Side side,
-                                                               int child_order_id) {
+private:
+    const ReplayRow& row_;
+    BacktestResult& backtest_;
+    std::uint64_t& market_traded_quantity_;
+};
+
+// Accumulates the fills of one child order as they stream out of the engine.
+struct ChildFillAccumulator {
+    Side side = Side::BUY;
+    int child_order_id = 0;
     int filled_quantity = 0;
     long double notional_ticks = 0.0L;
+    long double* total_notional_ticks = nullptr;
 
-    for (const auto& trade : trades) {
+    void operator()(const Trade& trade) {
         const bool involved =
-            side == Side::BUY ? (trade.buy_order_id == child_order_id)
-                              : (trade.sell_order_id == child_order_id);
+            side == Side::BUY ? (trade.buy_order_id == child_order_id) : (trade.sell_order_id == child_order_id);
         if (!involved) {
-            continue;
+            return;
         }
 
-        filled_quantity += trade.quantity;
-        notional_ticks +=
+        const long double trade_notional =
             static_cast<long double>(trade.price_ticks) * static_cast<long double>(trade.quantity);
+        filled_quantity += trade.quantity;
+        notional_ticks += trade_notional;
+        *total_notional_ticks += trade_notional;
     }
 
-    if (filled_quantity == 0) {
-        return std::nullopt;
+    std::optional<PriceTicks> average_fill_price_ticks() const {
+        if (filled_quantity == 0) {
+            return std::nullopt;
+        }
+        return static_cast<PriceTicks>(std::llround(notional_ticks / filled_quantity));
     }
-
-    return static_cast<PriceTicks>(std::llround(notional_ticks / filled_quantity));
-}
+};
 
 bool validate_config(const BacktestConfig& config, std::string& out_error) {
     if (config.target_quantity <= 0) {
@@ -190,31 +196,17 @@ std::vector<std::uint64_t> build_market_volume_profile_by_bucket(const std::vect
     const std::uint64_t start_ts = rows.front().ts_ns;
     const std::uint64_t end_ts = rows.back().ts_ns;
 
-    MatchingEngine market_engine;
-    for (const auto& row : rows) {
-        std::vector<Trade> trades;
-
-        if (row.action == ReplayAction::NEW) {
-            SubmitResult result = market_engine.submit(
-                {row.order_id, row.side, row.price_ticks, row.quantity, row.tif, row.type});
-            trades = std::move(result.trades);
-        } else if (row.action == ReplayAction::CANCEL) {
-            market_engine.cancel(row.order_id);
-        } else {
-            SubmitResult result =
-                market_engine.replace(row.order_id, row.new_price_ticks, row.new_quantity);
-            trades = std::move(result.trades);
+    MatchingEngine market_engine(untracked_engine_config());
+    auto add_volume = [&](const ReplayRow& row, const ActionResult& result, const Trade* trades) {
+        if (result.trade_count == 0) {
+            return;
         }
-
-        if (trades.empty()) {
-            continue;
+        std::uint64_t& volume = bucket_volume[bucket_index_for_ts(row.ts_ns, start_ts, end_ts, buckets)];
+        for (std::size_t t = 0; t < result.trade_count; ++t) {
+            volume += static_cast<std::uint64_t>(trades[t].quantity);
         }
-
-        const std::size_t bucket_idx = bucket_index_for_ts(row.ts_ns, start_ts, end_ts, buckets);
-        for (const auto& trade : trades) {
-            bucket_volume[bucket_idx] += static_cast<std::uint64_t>(trade.quantity);
-        }
-    }
+    };
+    apply_replay_rows(market_engine, rows, add_volume);
 
     return bucket_volume;
 }
@@ -338,19 +330,18 @@ bool run_execution_backtest_csv(const std::string& csv_path,
     }
 
     std::vector<ReplayRow> rows;
-    if (!parse_replay_csv_rows(csv_path, rows, out_error)) {
+    if (!load_replay_rows(csv_path, rows, out_error)) {
         return false;
     }
     if (rows.empty()) {
         out_error = "CSV has no replay rows";
         return false;
     }
-    sort_replay_rows(rows);
 
     const std::vector<std::uint64_t> schedule = build_even_schedule(rows, config.slices);
     const std::vector<int> slice_quantities = build_slice_quantities(rows, config);
 
-    MatchingEngine engine;
+    MatchingEngine engine(untracked_engine_config());
     out_result.child_orders.reserve(config.slices);
 
     int total_filled = 0;
@@ -391,27 +382,15 @@ bool run_execution_backtest_csv(const std::string& csv_path,
                 continue;
             }
 
+            ChildFillAccumulator fills{config.side, child_order_id, 0, 0.0L, &total_notional_ticks};
             SubmitResult result = engine.submit(
-                {child_order_id, config.side, 0, request_qty, TimeInForce::IOC, OrderType::MARKET});
+                {child_order_id, config.side, 0, request_qty, TimeInForce::IOC, OrderType::MARKET}, fills);
             child.accepted = result.accepted;
             child.reject_reason = result.reject_reason;
 
-            child.filled_quantity = fill_quantity_from_child_trades(result.trades, config.side, child_order_id);
-            child.average_fill_price_ticks =
-                average_fill_price_from_child_trades(result.trades, config.side, child_order_id);
-
-            if (child.filled_quantity > 0) {
-                total_filled += child.filled_quantity;
-                for (const auto& trade : result.trades) {
-                    const bool involved =
-                        config.side == Side::BUY ? (trade.buy_order_id == child_order_id)
-                                                 : (trade.sell_order_id == child_order_id);
-                    if (involved) {
-                        total_notional_ticks += static_cast<long double>(trade.price_ticks) *
-                                                static_cast<long double>(trade.quantity);
-                    }
-                }
-            }
+            child.filled_quantity = fills.filled_quantity;
+            child.average_fill_price_ticks = fills.average_fill_price_ticks();
+            total_filled += child.filled_quantity;
 
             out_result.child_orders.push_back(child);
             ++next_slice_index;
@@ -421,15 +400,15 @@ bool run_execution_backtest_csv(const std::string& csv_path,
     for (const auto& row : rows) {
         ++out_result.replay_stats.rows_processed;
 
+        MarketTradeRecorder record_trade(row, out_result, market_traded_quantity);
         if (row.action == ReplayAction::NEW) {
             SubmitResult result = engine.submit(
-                {row.order_id, row.side, row.price_ticks, row.quantity, row.tif, row.type});
+                {row.order_id, row.side, row.price_ticks, row.quantity, row.tif, row.type}, record_trade);
             if (result.accepted) {
                 ++out_result.replay_stats.accepted_actions;
             } else {
                 ++out_result.replay_stats.rejected_actions;
             }
-            append_market_trades(row, result.trades, out_result, market_traded_quantity);
         } else if (row.action == ReplayAction::CANCEL) {
             if (engine.cancel(row.order_id)) {
                 ++out_result.replay_stats.accepted_actions;
@@ -439,13 +418,13 @@ bool run_execution_backtest_csv(const std::string& csv_path,
                 ++out_result.replay_stats.cancel_not_found;
             }
         } else {
-            SubmitResult result = engine.replace(row.order_id, row.new_price_ticks, row.new_quantity);
+            SubmitResult result =
+                engine.replace(row.order_id, row.price_ticks, row.quantity, record_trade);
             if (result.accepted) {
                 ++out_result.replay_stats.accepted_actions;
             } else {
                 ++out_result.replay_stats.rejected_actions;
             }
-            append_market_trades(row, result.trades, out_result, market_traded_quantity);
         }
 
         send_due_slices(row.ts_ns);
@@ -59,6 +59,7 @@ using TwapConfig = BacktestConfig;
 using TwapChildExecution = ChildExecution;
 using TwapBacktestResult = BacktestResult;
 
+// `csv_path` may also name a .merb replay binary.
 bool run_execution_backtest_csv(const std::string& csv_path,
                                 const BacktestConfig& config,
                                 BacktestResult& out_result,
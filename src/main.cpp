@@ -10,6 +10,11 @@
 #include "csv_replay.h"
 #include "execution_backtest.h"
 #include "matching_engine.h"
+#include "order_flow_generator.h"
+#include "price_parse.h"
+#include "replay_bench.h"
+#include "replay_binary.h"
+#include "replay_trades.h"
 
 namespace {
 
@@ -99,6 +104,34 @@ bool parse_positive_int(const std::string& text, int& out_value) {
     return true;
 }
 
+template <typename Number>
+bool parse_non_negative(const std::string& text, Number& out_value) {
+    std::istringstream iss(text);
+    Number parsed{};
+    iss >> parsed;
+    if (iss.fail() || text.find('-') != std::string::npos) {
+        return false;
+    }
+
+    char trailing = '\0';
+    if (iss >> trailing) {
+        return false;
+    }
+
+    out_value = parsed;
+    return true;
+}
+
+bool parse_event_log_mode(const std::string& text, EventLogMode& out_mode) {
+    for (const EventLogMode mode : {EventLogMode::OFF, EventLogMode::RING, EventLogMode::FULL}) {
+        if (text == event_log_mode_name(mode)) {
+            out_mode = mode;
+            return true;
+        }
+    }
+    return false;
+}
+
 bool parse_side(const std::string& text, Side& out_side) {
     if (text == "BUY") {
         out_side = Side::BUY;
@@ -181,27 +214,27 @@ void print_events_since(const MatchingEngine& engine, std::uint64_t& last_seen_s
     std::cout << "Events (" << events.size() << "):\n";
     for (const auto& event : events) {
         std::cout << "  #" << event.seq_num << " " << event_type_to_cstr(event.type);
-        if (event.order_id.has_value()) {
-            std::cout << " oid=" << event.order_id.value();
+        if (event.order_id().has_value()) {
+            std::cout << " oid=" << event.order_id().value();
         }
-        if (event.side.has_value()) {
-            std::cout << " side=" << (event.side.value() == Side::BUY ? "BUY" : "SELL");
+        if (event.side().has_value()) {
+            std::cout << " side=" << (event.side().value() == Side::BUY ? "BUY" : "SELL");
         }
-        if (event.old_price_ticks.has_value()) {
-            std::cout << " old_px=" << fmt_price(event.old_price_ticks.value());
+        if (event.old_price_ticks().has_value()) {
+            std::cout << " old_px=" << fmt_price(event.old_price_ticks().value());
         }
-        if (event.old_quantity.has_value()) {
-            std::cout << " old_qty=" << event.old_quantity.value();
+        if (event.old_quantity().has_value()) {
+            std::cout << " old_qty=" << event.old_quantity().value();
         }
-        if (event.price_ticks.has_value()) {
-            std::cout << " px=" << fmt_price(event.price_ticks.value());
+        if (event.price_ticks().has_value()) {
+            std::cout << " px=" << fmt_price(event.price_ticks().value());
         }
-        if (event.quantity.has_value()) {
-            std::cout << " qty=" << event.quantity.value();
+        if (event.quantity().has_value()) {
+            std::cout << " qty=" << event.quantity().value();
         }
-        if (event.buy_order_id.has_value() && event.sell_order_id.has_value()) {
-            std::cout << " buy=" << event.buy_order_id.value()
-                      << " sell=" << event.sell_order_id.value();
+        if (event.buy_order_id().has_value() && event.sell_order_id().has_value()) {
+            std::cout << " buy=" << event.buy_order_id().value()
+                      << " sell=" << event.sell_order_id().value();
         }
         std::cout << '\n';
     }
@@ -212,25 +245,44 @@ void print_events_since(const MatchingEngine& engine, std::uint64_t& last_seen_s
 void print_usage(const char* program_name) {
     std::cout << "Usage:\n";
     std::cout << "  " << program_name << "\n";
-    std::cout << "  " << program_name << " replay <input.csv> [trades_out.csv]\n";
+    std::cout << "  " << program_name
+              << " replay [--stream] [--reorder-window=N] <input.csv> [trades_out.csv|trades_out.metl]\n";
+    std::cout << "  " << program_name
+              << " replay_merge [--reorder-window=N] [--trades=trades_out.csv] <input|glob>...\n";
     std::cout << "  " << program_name << " backtest_twap <input.csv> <BUY|SELL> <qty> <slices>\n";
     std::cout << "  " << program_name << " backtest_vwap <input.csv> <BUY|SELL> <qty> <slices>\n";
     std::cout << "  " << program_name << " backtest_compare <input.csv> <BUY|SELL> <qty> <slices>\n";
     std::cout << "  " << program_name
               << " backtest_batch <requests.csv> [runs_out.csv] [summary_out.csv]\n";
+    std::cout << "  " << program_name << " convert <input.csv> <output.merb>\n";
+    std::cout << "  " << program_name << " bench_replay [--no-latency] [--event-log=off|ring|full] [--json=out.json] <input>\n";
+    std::cout << "  " << program_name << " generate [--option=value]... <output.csv|output.merb>\n";
+    std::cout << "    options: rows seed rate start-ts cancel replace marketable market mid tick\n";
+    std::cout << "             mid-move level-decay max-levels mean-qty max-qty max-live\n";
+    std::cout << "Replay and backtest inputs may be CSV or .merb binaries.\n";
+    std::cout << "Replay trades are written as they happen; a .metl output is a binary trade log.\n";
 }
 
-int run_replay_mode(const std::string& input_csv,
-                    const std::optional<std::string>& trades_out_csv) {
-    MatchingEngine engine;
-    ReplayResult replay;
+// Opens the trades output, if any, so the replay can stream fills into it.
+bool open_trades_output(const std::optional<std::string>& trades_out,
+                        ReplayTradeWriter& writer,
+                        ReplayOptions& options) {
+    if (!trades_out.has_value()) {
+        return true;
+    }
     std::string error;
-
-    if (!replay_csv_file(input_csv, engine, replay, error)) {
-        std::cerr << "Replay failed: " << error << '\n';
-        return 1;
+    if (!writer.open(trades_out.value(), trade_output_format_for(trades_out.value()), error)) {
+        std::cerr << "Failed to write trades: " << error << '\n';
+        return false;
     }
+    options.trade_writer = &writer;
+    return true;
+}
 
+int report_replay(const MatchingEngine& engine,
+                  const ReplayResult& replay,
+                  const std::optional<std::string>& trades_out,
+                  ReplayTradeWriter& writer) {
     std::cout << "Replay complete\n";
     std::cout << "Rows processed: " << replay.stats.rows_processed << '\n';
     std::cout << "Accepted actions: " << replay.stats.accepted_actions << '\n';
@@ -241,17 +293,62 @@ int run_replay_mode(const std::string& input_csv,
     std::cout << "Final event seq: " << engine.last_seq_num() << '\n';
     print_book(engine, 5);
 
-    if (trades_out_csv.has_value()) {
-        if (!write_replay_trades_csv(trades_out_csv.value(), replay.trades, error)) {
-            std::cerr << "Failed to write trades CSV: " << error << '\n';
+    if (trades_out.has_value()) {
+        std::string error;
+        if (!writer.close(error)) {
+            std::cerr << "Failed to write trades: " << error << '\n';
             return 1;
         }
-        std::cout << "Wrote trades CSV: " << trades_out_csv.value() << '\n';
+        const bool is_log = trade_output_format_for(trades_out.value()) == TradeOutputFormat::LOG;
+        std::cout << (is_log ? "Wrote trade log: " : "Wrote trades CSV: ") << trades_out.value() << '\n';
     }
 
     return 0;
 }
 
+int run_replay_mode(const std::string& input_csv,
+                    const std::optional<std::string>& trades_out,
+                    ReplayOptions options) {
+    ReplayTradeWriter writer;
+    if (!open_trades_output(trades_out, writer, options)) {
+        return 1;
+    }
+
+    MatchingEngine engine;
+    ReplayResult replay;
+    std::string error;
+    if (!replay_csv_file(input_csv, engine, replay, error, options)) {
+        std::cerr << "Replay failed: " << error << '\n';
+        return 1;
+    }
+    return report_replay(engine, replay, trades_out, writer);
+}
+
+int run_replay_merge_mode(const std::vector<std::string>& inputs,
+                          const std::optional<std::string>& trades_out,
+                          ReplayOptions options) {
+    std::vector<std::string> paths;
+    std::string error;
+    if (!expand_replay_paths(inputs, paths, error)) {
+        std::cerr << "Replay failed: " << error << '\n';
+        return 1;
+    }
+
+    ReplayTradeWriter writer;
+    if (!open_trades_output(trades_out, writer, options)) {
+        return 1;
+    }
+
+    MatchingEngine engine;
+    ReplayResult replay;
+    if (!replay_csv_files(paths, engine, replay, error, options)) {
+        std::cerr << "Replay failed: " << error << '\n';
+        return 1;
+    }
+    std::cout << "Merged files: " << paths.size() << '\n';
+    return report_replay(engine, replay, trades_out, writer);
+}
+
 void print_backtest_report(const BacktestResult& backtest,
                            ExecutionStrategy strategy,
                            Side side,
@@ -479,6 +576,132 @@ int run_backtest_batch_mode(const std::string& requests_csv,
     return 0;
 }
 
+int run_convert_mode(const std::string& input_path, const std::string& output_path) {
+    std::vector<ReplayRow> rows;
+    std::string error;
+    if (!load_replay_rows(input_path, rows, error)) {
+        std::cerr << "Convert failed: " << error << '\n';
+        return 1;
+    }
+    if (!write_replay_binary(output_path, rows, error)) {
+        std::cerr << "Convert failed: " << error << '\n';
+        return 1;
+    }
+
+    std::cout << "Convert complete\n";
+    std::cout << "Rows: " << rows.size() << '\n';
+    std::cout << "Wrote replay binary: " << output_path << '\n';
+    return 0;
+}
+
+int run_bench_replay_mode(const std::string& input_path,
+                          const ReplayBenchOptions& options,
+                          const std::optional<std::string>& json_out) {
+    ReplayBenchResult bench;
+    std::string error;
+    if (!run_replay_bench(input_path, options, bench, error)) {
+        std::cerr << "Replay benchmark failed: " << error << '\n';
+        return 1;
+    }
+
+    std::cout << "Replay benchmark complete\n";
+    std::cout << "Rows: " << bench.rows << '\n';
+    std::cout << "Trades: " << bench.trades << '\n';
+    std::cout << "Event log: " << event_log_mode_name(bench.event_log_mode) << '\n';
+    std::cout << std::fixed << std::setprecision(6);
+    std::cout << "Parse seconds: " << bench.parse_seconds << '\n';
+    std::cout << "Sort seconds: " << bench.sort_seconds << '\n';
+    std::cout << "Match seconds: " << bench.match_seconds << '\n';
+    std::cout << std::setprecision(0);
+    std::cout << "Rows/s: " << bench.rows_per_second << '\n';
+    std::cout << "Trades/s: " << bench.trades_per_second << '\n';
+    if (options.measure_latency) {
+        std::cout << "Action latency ns: p50=" << bench.latency_p50_ns << " p99=" << bench.latency_p99_ns
+                  << " p99.9=" << bench.latency_p999_ns << " max=" << bench.latency_max_ns << '\n';
+    }
+    std::cout << "Peak RSS MiB: " << std::setprecision(1)
+              << static_cast<double>(bench.peak_rss_bytes) / (1024.0 * 1024.0) << '\n';
+
+    if (json_out.has_value()) {
+        if (!write_replay_bench_json(json_out.value(), input_path, bench, error)) {
+            std::cerr << "Failed to write benchmark JSON: " << error << '\n';
+            return 1;
+        }
+        std::cout << "Wrote benchmark JSON: " << json_out.value() << '\n';
+    }
+    return 0;
+}
+
+int run_generate_mode(const std::string& output_path, const OrderFlowConfig& config) {
+    OrderFlowStats stats;
+    std::string error;
+    if (!write_order_flow(output_path, config, replay_file_format_for(output_path), stats, error)) {
+        std::cerr << "Generate failed: " << error << '\n';
+        return 1;
+    }
+
+    std::cout << "Generate complete\n";
+    std::cout << "Rows: " << stats.rows << '\n';
+    std::cout << "New orders: " << stats.new_orders << " (marketable " << stats.marketable_orders << ")\n";
+    std::cout << "Cancels: " << stats.cancels << '\n';
+    std::cout << "Replaces: " << stats.replaces << '\n';
+    std::cout << "Wrote replay file: " << output_path << '\n';
+    return 0;
+}
+
+// Applies one generate --name=value option; false if the name or value is not valid.
+bool apply_generate_option(const std::string& name, const std::string& value, OrderFlowConfig& config) {
+    if (name == "rows") {
+        return parse_non_negative(value, config.rows);
+    }
+    if (name == "seed") {
+        return parse_non_negative(value, config.seed);
+    }
+    if (name == "rate") {
+        return parse_non_negative(value, config.arrivals_per_second);
+    }
+    if (name == "start-ts") {
+        return parse_non_negative(value, config.start_ts_ns);
+    }
+    if (name == "cancel") {
+        return parse_non_negative(value, config.cancel_fraction);
+    }
+    if (name == "replace") {
+        return parse_non_negative(value, config.replace_fraction);
+    }
+    if (name == "marketable") {
+        return parse_non_negative(value, config.marketable_fraction);
+    }
+    if (name == "market") {
+        return parse_non_negative(value, config.market_order_fraction);
+    }
+    if (name == "mid") {
+        return parse_decimal_price_ticks(value, config.start_mid_ticks);
+    }
+    if (name == "tick") {
+        return parse_decimal_price_ticks(value, config.tick_size_ticks);
+    }
+    if (name == "mid-move") {
+        return parse_non_negative(value, config.mid_move_probability);
+    }
+    if (name == "level-decay") {
+        return parse_non_negative(value, config.level_decay);
+    }
+    if (name == "max-levels") {
+        return parse_positive_int(value, config.max_levels);
+    }
+    if (name == "mean-qty") {
+        return parse_non_negative(value, config.mean_quantity);
+    }
+    if (name == "max-qty") {
+        return parse_positive_int(value, config.max_quantity);
+    }
+    if (name == "max-live") {
+        return parse_non_negative(value, config.max_live_orders);
+    }
+    return false;
+}
+
 int run_demo_mode() {
     MatchingEngine engine;
     std::uint64_t last_seen_seq_num = 0;
@@ -554,17 +777,47 @@ int main(int argc, char** argv) {
     }
 
     const std::string mode = argv[1];
-    if (mode == "replay") {
-        if (argc < 3 || argc > 4) {
+    if (mode == "replay" || mode == "replay_merge") {
+        ReplayOptions options;
+        std::optional<std::string> trades_output;
+        std::vector<std::string> positional;
+        for (int i = 2; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const std::string window_flag = "--reorder-window=";
+            const std::string trades_flag = "--trades=";
+            if (arg == "--stream" && mode == "replay") {
+                options.streaming = true;
+            } else if (arg.compare(0, window_flag.size(), window_flag) == 0) {
+                int window = 0;
+                const std::string value = arg.substr(window_flag.size());
+                if (value != "0" && !parse_positive_int(value, window)) {
+                    std::cerr << "Invalid reorder window '" << value << "' (expected non-negative integer)\n";
+                    return 2;
+                }
+                options.streaming = true;
+                options.reorder_window = static_cast<std::size_t>(window);
+            } else if (arg.compare(0, trades_flag.size(), trades_flag) == 0 && mode == "replay_merge") {
+                trades_output = arg.substr(trades_flag.size());
+            } else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (mode == "replay_merge") {
+            if (positional.empty()) {
+                print_usage(argv[0]);
+                return 2;
+            }
+            return run_replay_merge_mode(positional, trades_output, options);
+        }
+        if (positional.empty() || positional.size() > 2) {
             print_usage(argv[0]);
             return 2;
         }
-
-        std::optional<std::string> trades_output;
-        if (argc == 4) {
-            trades_output = argv[3];
+        if (positional.size() == 2) {
+            trades_output = positional[1];
         }
-        return run_replay_mode(argv[2], trades_output);
+        return run_replay_mode(positional[0], trades_output, options);
     }
 
     if (mode == "backtest_twap" || mode == "backtest_vwap" || mode == "backtest_compare") {
@@ -618,6 +871,66 @@ int main(int argc, char** argv) {
         return run_backtest_batch_mode(argv[2], runs_output, summary_output);
     }
 
+    if (mode == "bench_replay") {
+        ReplayBenchOptions options;
+        std::optional<std::string> json_output;
+        std::vector<std::string> positional;
+        const std::string json_flag = "--json=";
+        const std::string event_log_flag = "--event-log=";
+        for (int i = 2; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg == "--no-latency") {
+                options.measure_latency = false;
+            } else if (arg.compare(0, event_log_flag.size(), event_log_flag) == 0) {
+                const std::string value = arg.substr(event_log_flag.size());
+                if (!parse_event_log_mode(value, options.engine.event_log_mode)) {
+                    std::cerr << "Invalid event log mode '" << value << "' (expected off, ring or full)\n";
+                    return 2;
+                }
+            } else if (arg.compare(0, json_flag.size(), json_flag) == 0) {
+                json_output = arg.substr(json_flag.size());
+            } else {
+                positional.push_back(arg);
+            }
+        }
+        if (positional.size() != 1) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        return run_bench_replay_mode(positional[0], options, json_output);
+    }
+
+    if (mode == "generate") {
+        OrderFlowConfig config;
+        std::vector<std::string> positional;
+        for (int i = 2; i < argc; ++i) {
+            const std::string arg = argv[i];
+            const std::size_t equals = arg.find('=');
+            if (arg.compare(0, 2, "--") != 0 || equals == std::string::npos) {
+                positional.push_back(arg);
+                continue;
+            }
+            const std::string name = arg.substr(2, equals - 2);
+            if (!apply_generate_option(name, arg.substr(equals + 1), config)) {
+                std::cerr << "Invalid generate option '" << arg << "'\n";
+                return 2;
+            }
+        }
+        if (positional.size() != 1) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        return run_generate_mode(positional[0], config);
+    }
+
+    if (mode == "convert") {
+        if (argc != 4) {
+            print_usage(argv[0]);
+            return 2;
+        }
+        return run_convert_mode(argv[2], argv[3]);
+    }
+
     print_usage(argv[0]);
     return 2;
 }
@@ -0,0 +1,123 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <utility>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      buffer_(std::move(other.buffer_)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        buffer_ = std::move(other.buffer_);
+    }
+    return *this;
+}
+
+namespace {
+
+// Reads `fd` to the end into `out_buffer`.
+bool read_all(int fd, std::vector<char>& out_buffer) {
+    constexpr std::size_t kReadBytes = std::size_t{1} << 20;
+    std::size_t used = 0;
+    while (true) {
+        out_buffer.resize(used + kReadBytes);
+        const ssize_t count = ::read(fd, out_buffer.data() + used, kReadBytes);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (count == 0) {
+            break;
+        }
+        used += static_cast<std::size_t>(count);
+    }
+    out_buffer.resize(used);
+    out_buffer.shrink_to_fit();
+    return true;
+}
+
+}  // namespace
+
+bool MappedFile::open(const std::string& path, std::string& out_error) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        out_error = "failed to open file: " + path;
+        return false;
+    }
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || S_ISDIR(info.st_mode)) {
+        ::close(fd);
+        out_error = "failed to open file: " + path;
+        return false;
+    }
+
+    if (!S_ISREG(info.st_mode)) {
+        const bool read_ok = read_all(fd, buffer_);
+        ::close(fd);
+        if (!read_ok) {
+            buffer_.clear();
+            out_error = "failed to read file: " + path;
+            return false;
+        }
+        // An empty input gets the same null view as an empty regular file.
+        data_ = buffer_.empty() ? nullptr : buffer_.data();
+        size_ = buffer_.size();
+        return true;
+    }
+
+    if (info.st_size == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    const auto length = static_cast<std::size_t>(info.st_size);
+    void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        out_error = "failed to map file: " + path;
+        return false;
+    }
+
+    // Parsers walk the mapping front to back once.
+    ::madvise(mapping, length, MADV_SEQUENTIAL);
+    data_ = static_cast<const char*>(mapping);
+    size_ = length;
+    return true;
+}
+
+void MappedFile::release_before(std::size_t offset) {
+    const auto page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t length = std::min(offset, size_) / page_size * page_size;
+    if (data_ != nullptr && buffer_.empty() && length != 0) {
+        ::madvise(const_cast<char*>(data_), length, MADV_DONTNEED);
+    }
+}
+
+void MappedFile::close() {
+    if (data_ != nullptr && buffer_.empty()) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+    std::vector<char>().swap(buffer_);
+    data_ = nullptr;
+    size_ = 0;
+}
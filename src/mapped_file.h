@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only memory mapping of a whole file. Empty files map to an empty view. Inputs that
+// cannot be mapped, such as pipes and /dev/stdin, are read once into an owned buffer instead.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Returns false if the file cannot be opened or mapped; `out_error` then names `path`.
+    bool open(const std::string& path, std::string& out_error);
+    void close();
+    // Drops the resident pages wholly before `offset`; later reads of them fault back in.
+    // Does nothing for a buffered (unmapped) input.
+    void release_before(std::size_t offset);
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    // Holds the contents of a non-regular input; empty when data_ is a mapping.
+    std::vector<char> buffer_;
+};
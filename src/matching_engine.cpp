@@ -1,200 +1,438 @@
 #include "matching_engine.h"
 
 #include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace {
+
+template <Side S>
+constexpr PriceTicks kMarketLimitTicks = S == Side::BUY ? std::numeric_limits<PriceTicks>::max()
+                                                        : std::numeric_limits<PriceTicks>::min();
+
+// True when an aggressor on side `S` limited at `limit_ticks` trades against `resting_ticks`.
+template <Side S>
+bool crosses(PriceTicks limit_ticks, PriceTicks resting_ticks) {
+    if constexpr (S == Side::BUY) {
+        return limit_ticks >= resting_ticks;
+    } else {
+        return limit_ticks <= resting_ticks;
+    }
+}
+
+template <Side S>
+Trade make_trade(int aggressor_id, int resting_id, PriceTicks price_ticks, int quantity) {
+    if constexpr (S == Side::BUY) {
+        return {aggressor_id, resting_id, price_ticks, quantity};
+    } else {
+        return {resting_id, aggressor_id, price_ticks, quantity};
+    }
+}
+
+}  // namespace
+
+const char* event_log_mode_name(EventLogMode mode) {
+    switch (mode) {
+        case EventLogMode::OFF:
+            return "off";
+        case EventLogMode::RING:
+            return "ring";
+        case EventLogMode::FULL:
+            return "full";
+    }
+    return "unknown";
+}
+
+MatchingEngine::MatchingEngine(const EngineConfig& config)
+    : bids_(config.book),
+      asks_(config.book),
+      order_index_(config.initial_order_capacity),
+      event_log_mode_(config.event_log_mode),
+      // EventLog treats capacity 0 as unbounded, so a RING log keeps at least one event.
+      events_(config.event_log_mode == EventLogMode::RING ? std::max<std::size_t>(config.event_log_capacity, 1)
+                                                          : 0) {}
 
 void MatchingEngine::push_event(BookEvent event) {
     event.seq_num = next_seq_num_++;
-    events_.push_back(event);
+    events_.append(event);
 }
 
 void MatchingEngine::push_trade_event(const Trade& trade) {
-    BookEvent event;
-    event.type = BookEventType::TRADE;
-    event.price_ticks = trade.price_ticks;
-    event.quantity = trade.quantity;
-    event.buy_order_id = trade.buy_order_id;
-    event.sell_order_id = trade.sell_order_id;
-    push_event(event);
+    record_event([&] { return BookEvent::trade(trade); });
 }
 
 void MatchingEngine::push_add_event(const Order& order) {
-    BookEvent event;
-    event.type = BookEventType::ADD;
-    event.order_id = order.id;
-    event.side = order.side;
-    event.price_ticks = order.price_ticks;
-    event.quantity = order.quantity;
-    push_event(event);
+    record_event([&] { return BookEvent::add(order); });
 }
 
 void MatchingEngine::push_cancel_event(const Order& order) {
-    BookEvent event;
-    event.type = BookEventType::CANCEL;
-    event.order_id = order.id;
-    event.side = order.side;
-    event.price_ticks = order.price_ticks;
-    event.quantity = order.quantity;
-    push_event(event);
+    record_event([&] { return BookEvent::cancel(order); });
 }
 
 void MatchingEngine::push_replace_event(const Order& old_order, const Order& new_order) {
-    BookEvent event;
-    event.type = BookEventType::REPLACE;
-    event.order_id = old_order.id;
-    event.side = old_order.side;
-    event.old_price_ticks = old_order.price_ticks;
-    event.old_quantity = old_order.quantity;
-    event.price_ticks = new_order.price_ticks;
-    event.quantity = new_order.quantity;
-    push_event(event);
+    record_event([&] { return BookEvent::replace(old_order, new_order); });
 }
 
-SubmitResult MatchingEngine::submit(Order order) {
-    SubmitResult result;
+template <Side S>
+OrderBook<S>& MatchingEngine::book() {
+    if constexpr (S == Side::BUY) {
+        return bids_;
+    } else {
+        return asks_;
+    }
+}
 
+template <Side S>
+void MatchingEngine::submit_side(Order& order, SubmitResult& result, TradeSink on_trade) {
     if (order.quantity <= 0) {
         result.reject_reason = RejectReason::INVALID_QUANTITY;
-        return result;
+        return;
     }
-    if (order.type == OrderType::LIMIT && order.price_ticks <= 0) {
+    if (order.type == OrderType::LIMIT &&
+        (order.price_ticks <= 0 || !book<S>().accepts_price(order.price_ticks))) {
         result.reject_reason = RejectReason::INVALID_PRICE;
-        return result;
+        return;
     }
-    if (has_order(order.id)) {
+    submit_prechecked<S>(order, result, on_trade);
+}
+
+template <Side S>
+void MatchingEngine::submit_prechecked(Order& order, SubmitResult& result, TradeSink on_trade) {
+    OrderBook<S>& same_side = book<S>();
+    OrderBook<opposite(S)>& opposite_side = book<opposite(S)>();
+    if (find_live(order.id) != nullptr) {
         result.reject_reason = RejectReason::DUPLICATE_ORDER_ID;
-        return result;
+        return;
     }
 
-    OrderBook& same_side = order.side == Side::BUY ? bids_ : asks_;
-    OrderBook& opposite_side = order.side == Side::BUY ? asks_ : bids_;
     if (order.type == OrderType::MARKET && opposite_side.empty()) {
         result.reject_reason = RejectReason::NO_LIQUIDITY;
-        return result;
+        return;
     }
 
     result.accepted = true;
     result.reject_reason = RejectReason::NONE;
 
-    auto crosses = [&](PriceTicks opposite_price_ticks) {
-        if (order.type == OrderType::MARKET) {
-            return true;
-        }
-        if (order.side == Side::BUY) {
-            return order.price_ticks >= opposite_price_ticks;
-        }
-        return order.price_ticks <= opposite_price_ticks;
-    };
+    // A market order behaves as a limit at the far end of the price range.
+    const PriceTicks limit_ticks =
+        order.type == OrderType::MARKET ? kMarketLimitTicks<S> : order.price_ticks;
+    const int requested_quantity = order.quantity;
 
     while (order.quantity > 0 && !opposite_side.empty() &&
-           crosses(opposite_side.best_price_ticks())) {
-        Order& resting = opposite_side.best_order();
+           crosses<S>(limit_ticks, opposite_side.best_price_ticks())) {
+        if (order.quantity >= opposite_side.best_level_quantity()) {
+            // The whole level fills: emit its trades in one pass and drop it in bulk.
+            order.quantity -= opposite_side.consume_best_level([&](const Order& resting) {
+                const Trade trade =
+                    make_trade<S>(order.id, resting.id, resting.price_ticks, resting.quantity);
+                on_trade(trade);
+                push_trade_event(trade);
+                order_index_.erase(resting.id);
+            });
+            continue;
+        }
+
+        const Order& resting = opposite_side.best_order();
+        const int resting_id = resting.id;
         const int executed_qty = std::min(order.quantity, resting.quantity);
 
-        result.trades.push_back({
-            order.side == Side::BUY ? order.id : resting.id,
-            order.side == Side::BUY ? resting.id : order.id,
-            resting.price_ticks,
-            executed_qty
-        });
-        push_trade_event(result.trades.back());
+        const Trade trade = make_trade<S>(order.id, resting_id, resting.price_ticks, executed_qty);
+        on_trade(trade);
+        push_trade_event(trade);
 
         order.quantity -= executed_qty;
-        resting.quantity -= executed_qty;
-
-        if (resting.quantity == 0) {
-            opposite_side.consume_best();
+        if (opposite_side.fill_best(executed_qty)) {
+            order_index_.erase(resting_id);
         }
     }
 
     if (order.quantity > 0 && order.type == OrderType::LIMIT && order.tif == TimeInForce::GTC) {
-        same_side.add(order);
+        // Only a remainder that rests can stretch the dense band. One that would stretch it
+        // too far is refused if nothing filled, and otherwise dropped as an IOC remainder is.
+        if (!same_side.fits_price(order.price_ticks)) {
+            if (order.quantity == requested_quantity) {
+                result.accepted = false;
+                result.reject_reason = RejectReason::INVALID_PRICE;
+            }
+            return;
+        }
+        purge_stale_entries_before_growth();
+        const OrderNodeIndex node = same_side.add(order);
+        const std::uint32_t generation = same_side.generation_of(node);
+        order_index_.insert(order.id, S, node, generation);
+        result.handle = OrderHandle{node, generation, S};
         push_add_event(order);
     }
+}
 
+SubmitResult MatchingEngine::submit(Order order, TradeSink on_trade) {
+    SubmitResult result;
+    if (order.side == Side::BUY) {
+        submit_side<Side::BUY>(order, result, on_trade);
+    } else {
+        submit_side<Side::SELL>(order, result, on_trade);
+    }
+    return result;
+}
+
+SubmitResult MatchingEngine::submit(Order order) {
+    std::vector<Trade> trades;
+    SubmitResult result = submit(order, [&trades](const Trade& trade) { trades.push_back(trade); });
+    result.trades = std::move(trades);
     return result;
 }
 
 bool MatchingEngine::cancel(int order_id) {
-    auto removed_bid = bids_.remove(order_id);
-    if (removed_bid.has_value()) {
-        push_cancel_event(removed_bid.value());
-        return true;
+    const OrderIndex::Entry* entry = find_live(order_id);
+    if (entry == nullptr) {
+        return false;
     }
 
-    auto removed_ask = asks_.remove(order_id);
-    if (removed_ask.has_value()) {
-        push_cancel_event(removed_ask.value());
-        return true;
+    const Order removed = entry->side == Side::BUY ? bids_.remove(entry->node)
+                                                   : asks_.remove(entry->node);
+    order_index_.erase(entry);
+    push_cancel_event(removed);
+    return true;
+}
+
+bool MatchingEngine::cancel(OrderHandle handle) {
+    if (!handle_live(handle)) {
+        return false;
     }
-    return false;
+
+    const Order removed = handle.side == Side::BUY ? bids_.remove(handle.node) : asks_.remove(handle.node);
+    ++stale_index_entries_;
+    push_cancel_event(removed);
+    return true;
 }
 
-SubmitResult MatchingEngine::replace(int order_id, PriceTicks new_price_ticks, int new_quantity) {
+template <Side S>
+SubmitResult MatchingEngine::replace_resting(OrderNodeIndex node,
+                                             const OrderIndex::Entry* entry,
+                                             PriceTicks new_price_ticks,
+                                             int new_quantity,
+                                             TradeSink on_trade) {
     SubmitResult result;
-
-    if (new_quantity <= 0) {
-        result.reject_reason = RejectReason::INVALID_QUANTITY;
+    OrderBook<S>& same_side = book<S>();
+    const Order& existing = same_side.order_at(node);
+    // A new price that cannot trade would rest as it is; checking its span with the order
+    // still resting means a refused replace leaves the order in place. A price that trades
+    // is checked only for its remainder, when that is about to rest.
+    const OrderBook<opposite(S)>& opposite_side = book<opposite(S)>();
+    const bool trades = !opposite_side.empty() && crosses<S>(new_price_ticks, opposite_side.best_price_ticks());
+    if (!trades && !same_side.fits_price(new_price_ticks)) {
+        result.reject_reason = RejectReason::INVALID_PRICE;
         return result;
     }
-    if (new_price_ticks <= 0) {
-        result.reject_reason = RejectReason::INVALID_PRICE;
+    if (existing.price_ticks == new_price_ticks && new_quantity <= existing.quantity) {
+        const Order old_order = existing;
+        same_side.reduce_quantity(node, new_quantity);
+        push_replace_event(old_order, existing);
+        result.accepted = true;
+        result.reject_reason = RejectReason::NONE;
+        result.handle = OrderHandle{node, same_side.generation_of(node), S};
         return result;
     }
 
-    OrderBook* same_side = nullptr;
-    Order* existing = bids_.find_mutable(order_id);
-    if (existing != nullptr) {
-        same_side = &bids_;
+    const Order removed = same_side.remove(node);
+    if (entry != nullptr) {
+        order_index_.erase(entry);
     } else {
-        existing = asks_.find_mutable(order_id);
-        if (existing != nullptr) {
-            same_side = &asks_;
-        }
+        ++stale_index_entries_;
     }
 
-    if (existing == nullptr || same_side == nullptr) {
-        result.reject_reason = RejectReason::ORDER_NOT_FOUND;
+    Order replacement = removed;
+    replacement.price_ticks = new_price_ticks;
+    replacement.quantity = new_quantity;
+    replacement.tif = TimeInForce::GTC;
+    replacement.type = OrderType::LIMIT;
+    push_replace_event(removed, replacement);
+
+    submit_side<S>(replacement, result, on_trade);
+    return result;
+}
+
+SubmitResult MatchingEngine::replace(int order_id,
+                                     PriceTicks new_price_ticks,
+                                     int new_quantity,
+                                     TradeSink on_trade) {
+    SubmitResult result;
+    if (!validate_replace(new_price_ticks, new_quantity, result)) {
         return result;
     }
+    return replace_prechecked(order_id, new_price_ticks, new_quantity, on_trade);
+}
 
-    if (existing->price_ticks == new_price_ticks && new_quantity <= existing->quantity) {
-        const Order old_order = *existing;
-        existing->quantity = new_quantity;
-        push_replace_event(old_order, *existing);
-        result.accepted = true;
-        result.reject_reason = RejectReason::NONE;
+SubmitResult MatchingEngine::replace_prechecked(int order_id,
+                                                PriceTicks new_price_ticks,
+                                                int new_quantity,
+                                                TradeSink on_trade) {
+    SubmitResult result;
+    const OrderIndex::Entry* entry = find_live(order_id);
+    if (entry == nullptr) {
+        result.reject_reason = RejectReason::ORDER_NOT_FOUND;
         return result;
     }
 
-    auto removed = same_side->remove(order_id);
-    if (!removed.has_value()) {
+    if (entry->side == Side::BUY) {
+        return replace_resting<Side::BUY>(entry->node, entry, new_price_ticks, new_quantity, on_trade);
+    }
+    return replace_resting<Side::SELL>(entry->node, entry, new_price_ticks, new_quantity, on_trade);
+}
+
+SubmitResult MatchingEngine::replace(OrderHandle handle,
+                                     PriceTicks new_price_ticks,
+                                     int new_quantity,
+                                     TradeSink on_trade) {
+    SubmitResult result;
+    if (!validate_replace(new_price_ticks, new_quantity, result)) {
+        return result;
+    }
+    if (!handle_live(handle)) {
         result.reject_reason = RejectReason::ORDER_NOT_FOUND;
         return result;
     }
 
-    Order replacement = removed.value();
-    replacement.price_ticks = new_price_ticks;
-    replacement.quantity = new_quantity;
-    replacement.tif = TimeInForce::GTC;
-    replacement.type = OrderType::LIMIT;
-    push_replace_event(removed.value(), replacement);
+    if (handle.side == Side::BUY) {
+        return replace_resting<Side::BUY>(handle.node, nullptr, new_price_ticks, new_quantity, on_trade);
+    }
+    return replace_resting<Side::SELL>(handle.node, nullptr, new_price_ticks, new_quantity, on_trade);
+}
 
-    return submit(replacement);
+SubmitResult MatchingEngine::replace(OrderHandle handle, PriceTicks new_price_ticks, int new_quantity) {
+    std::vector<Trade> trades;
+    SubmitResult result = replace(handle, new_price_ticks, new_quantity,
+                                  [&trades](const Trade& trade) { trades.push_back(trade); });
+    result.trades = std::move(trades);
+    return result;
 }
 
-TopOfBook MatchingEngine::top_of_book() const {
-    TopOfBook top;
+void MatchingEngine::process_batch(const EngineAction* actions,
+                                   std::size_t count,
+                                   ActionResult* out_results,
+                                   std::vector<Trade>& out_trades) {
+    // Pass 1: reject on quantity and price sign alone, in the same order submit/replace check
+    // them. No book access; the per-action field choices are selects, not calls.
+    for (std::size_t i = 0; i < count; ++i) {
+        const EngineAction& action = actions[i];
+        const bool is_replace = action.type == EngineActionType::REPLACE;
+        const bool checks_price =
+            is_replace || (action.type == EngineActionType::NEW && action.order.type == OrderType::LIMIT);
+        const PriceTicks price = is_replace ? action.new_price_ticks : action.order.price_ticks;
+        const int quantity = is_replace ? action.new_quantity : action.order.quantity;
+        const bool bad_quantity = action.type != EngineActionType::CANCEL && quantity <= 0;
+        const bool bad_price = checks_price && price <= 0;
+        out_results[i] = ActionResult{};
+        out_results[i].reject_reason = bad_quantity ? RejectReason::INVALID_QUANTITY
+                                       : bad_price  ? RejectReason::INVALID_PRICE
+                                                    : RejectReason::NONE;
+    }
+
+    // Pass 1b, dense ladder only: the tick-grid check. A 64-bit modulo is a division, so the
+    // map backend (grid 1) skips this loop rather than paying for it on every action.
+    const PriceTicks grid = bids_.price_grid_ticks();
+    if (grid != 1) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const EngineAction& action = actions[i];
+            const bool is_replace = action.type == EngineActionType::REPLACE;
+            const bool checks_price =
+                is_replace || (action.type == EngineActionType::NEW && action.order.type == OrderType::LIMIT);
+            const PriceTicks price = is_replace ? action.new_price_ticks : action.order.price_ticks;
+            if (checks_price && out_results[i].reject_reason == RejectReason::NONE && price % grid != 0) {
+                out_results[i].reject_reason = RejectReason::INVALID_PRICE;
+            }
+        }
+    }
+
+    // Pass 2: apply the surviving actions in order against the book.
+    auto append_trade = [&out_trades](const Trade& trade) { out_trades.push_back(trade); };
+    for (std::size_t i = 0; i < count; ++i) {
+        ActionResult& out = out_results[i];
+        out.first_trade = out_trades.size();
+        if (out.reject_reason != RejectReason::NONE) {
+            continue;
+        }
 
-    auto bid_depth = bids_.depth(1);
-    if (!bid_depth.empty()) {
-        top.best_bid = bid_depth.front();
+        const EngineAction& action = actions[i];
+        SubmitResult result;
+        if (action.type == EngineActionType::NEW) {
+            Order order = action.order;
+            if (order.side == Side::BUY) {
+                submit_prechecked<Side::BUY>(order, result, append_trade);
+            } else {
+                submit_prechecked<Side::SELL>(order, result, append_trade);
+            }
+        } else if (action.type == EngineActionType::CANCEL) {
+            result.accepted = cancel(action.order.id);
+            result.reject_reason = result.accepted ? RejectReason::NONE : RejectReason::ORDER_NOT_FOUND;
+        } else {
+            result = replace_prechecked(action.order.id, action.new_price_ticks, action.new_quantity,
+                                        append_trade);
+        }
+
+        out.accepted = result.accepted;
+        out.reject_reason = result.reject_reason;
+        out.handle = result.handle;
+        out.trade_count = out_trades.size() - out.first_trade;
     }
+}
 
-    auto ask_depth = asks_.depth(1);
-    if (!ask_depth.empty()) {
-        top.best_ask = ask_depth.front();
+bool MatchingEngine::validate_replace(PriceTicks new_price_ticks, int new_quantity, SubmitResult& result) const {
+    if (new_quantity <= 0) {
+        result.reject_reason = RejectReason::INVALID_QUANTITY;
+        return false;
+    }
+    if (new_price_ticks <= 0 || !bids_.accepts_price(new_price_ticks)) {
+        result.reject_reason = RejectReason::INVALID_PRICE;
+        return false;
     }
+    return true;
+}
+
+bool MatchingEngine::handle_live(const OrderHandle& handle) const {
+    return handle.side == Side::BUY ? bids_.holds(handle.node, handle.generation)
+                                    : asks_.holds(handle.node, handle.generation);
+}
+
+bool MatchingEngine::entry_live(const OrderIndex::Entry& entry) const {
+    return entry.side == Side::BUY ? bids_.holds(entry.node, entry.generation)
+                                   : asks_.holds(entry.node, entry.generation);
+}
+
+const OrderIndex::Entry* MatchingEngine::find_live(int order_id) {
+    const OrderIndex::Entry* entry = order_index_.find(order_id);
+    if (entry == nullptr || stale_index_entries_ == 0 || entry_live(*entry)) {
+        return entry;
+    }
+    order_index_.erase(entry);
+    --stale_index_entries_;
+    return nullptr;
+}
 
+void MatchingEngine::purge_stale_entries_before_growth() {
+    // Drop stale entries instead of growing when they make up a real share of the table;
+    // each purge then pays for itself over the handle operations that left them.
+    if (stale_index_entries_ == 0 || !order_index_.at_growth_threshold() ||
+        stale_index_entries_ * 4 < order_index_.size()) {
+        return;
+    }
+    const std::size_t dropped =
+        order_index_.purge([this](const OrderIndex::Entry& entry) { return entry_live(entry); });
+    stale_index_entries_ -= dropped;
+}
+
+SubmitResult MatchingEngine::replace(int order_id, PriceTicks new_price_ticks, int new_quantity) {
+    std::vector<Trade> trades;
+    SubmitResult result = replace(order_id, new_price_ticks, new_quantity,
+                                  [&trades](const Trade& trade) { trades.push_back(trade); });
+    result.trades = std::move(trades);
+    return result;
+}
+
+TopOfBook MatchingEngine::top_of_book() const {
+    TopOfBook top;
+    top.best_bid = bids_.best_level();
+    top.best_ask = asks_.best_level();
     return top;
 }
 
@@ -206,22 +444,10 @@ BookSnapshot MatchingEngine::depth(std::size_t n_levels) const {
 }
 
 std::uint64_t MatchingEngine::last_seq_num() const {
-    if (events_.empty()) {
-        return 0;
-    }
-    return events_.back().seq_num;
-}
-
-std::vector<BookEvent> MatchingEngine::events_since(std::uint64_t seq_num) const {
-    std::vector<BookEvent> events;
-    for (const auto& event : events_) {
-        if (event.seq_num > seq_num) {
-            events.push_back(event);
-        }
-    }
-    return events;
+    return next_seq_num_ - 1;
 }
 
 bool MatchingEngine::has_order(int order_id) const {
-    return bids_.contains(order_id) || asks_.contains(order_id);
+    const OrderIndex::Entry* entry = order_index_.find(order_id);
+    return entry != nullptr && (stale_index_entries_ == 0 || entry_live(*entry));
 }
@@ -2,9 +2,14 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
 #include <vector>
 
+#include "event_log.h"
 #include "order_book.h"
+#include "order_index.h"
 
 enum class RejectReason {
     NONE,
@@ -15,36 +20,181 @@ enum class RejectReason {
     ORDER_NOT_FOUND
 };
 
+// Opaque reference to a resting order: its pool slot, the slot's generation and the side.
+// Cancel/replace through a handle skip the order-id lookup. A handle goes stale once its
+// order leaves the book, and operations on it then fail with ORDER_NOT_FOUND.
+struct OrderHandle {
+    OrderNodeIndex node = kNullOrderNode;
+    std::uint32_t generation = 0;
+    Side side = Side::BUY;
+
+    bool valid() const { return node != kNullOrderNode; }
+};
+
 struct SubmitResult {
     bool accepted = false;
     RejectReason reject_reason = RejectReason::NONE;
     std::vector<Trade> trades;
+    // Set when the order (or its remainder) rests in the book.
+    OrderHandle handle;
+};
+
+enum class EngineActionType : std::uint8_t { NEW, CANCEL, REPLACE };
+
+// One entry of a process_batch() input. NEW submits `order`; CANCEL and REPLACE name
+// their target by `order.id`, and REPLACE takes its new price/quantity from the last two fields.
+struct EngineAction {
+    EngineActionType type = EngineActionType::NEW;
+    Order order{};
+    PriceTicks new_price_ticks = 0;
+    int new_quantity = 0;
+};
+
+// Outcome of one batch action. Its trades are out_trades[first_trade, first_trade + trade_count).
+struct ActionResult {
+    bool accepted = false;
+    RejectReason reject_reason = RejectReason::NONE;
+    std::size_t first_trade = 0;
+    std::size_t trade_count = 0;
+    OrderHandle handle;
+};
+
+// Non-owning reference to a callable invoked once per trade, in execution order.
+// Only valid for the duration of the submit/replace call it is passed to.
+class TradeSink {
+public:
+    template <typename Callback,
+              typename = std::enable_if_t<!std::is_same_v<std::decay_t<Callback>, TradeSink>>>
+    TradeSink(Callback&& callback)  // NOLINT: implicit so lambdas can be passed directly.
+        : context_(const_cast<void*>(static_cast<const void*>(std::addressof(callback)))),
+          emit_([](void* context, const Trade& trade) {
+              (*static_cast<std::remove_reference_t<Callback>*>(context))(trade);
+          }) {}
+
+    void operator()(const Trade& trade) const { emit_(context_, trade); }
+
+private:
+    void* context_;
+    void (*emit_)(void*, const Trade&);
+};
+
+// What the engine keeps of its sequenced event stream. Sequence numbers advance in every
+// mode, so last_seq_num() is the same whether or not events are captured.
+enum class EventLogMode {
+    OFF,   // No events are built or stored.
+    RING,  // The newest `event_log_capacity` events.
+    FULL   // Every event of the session.
+};
+
+// "off", "ring" or "full".
+const char* event_log_mode_name(EventLogMode mode);
+
+struct EngineConfig {
+    OrderBookConfig book;
+    // Expected number of simultaneously resting orders; presizes the order-id index.
+    std::size_t initial_order_capacity = 0;
+    EventLogMode event_log_mode = EventLogMode::FULL;
+    // Ring size for EventLogMode::RING; ignored by the other modes.
+    std::size_t event_log_capacity = 65536;
 };
 
 class MatchingEngine {
 public:
+    MatchingEngine() = default;
+    explicit MatchingEngine(const EngineConfig& config);
+
     SubmitResult submit(Order order);
     bool cancel(int order_id);
     SubmitResult replace(int order_id, PriceTicks new_price_ticks, int new_quantity);
+
+    // Streaming variants: trades go to `on_trade` instead of SubmitResult::trades, which
+    // stays empty, so these never allocate on behalf of the caller.
+    SubmitResult submit(Order order, TradeSink on_trade);
+    SubmitResult replace(int order_id, PriceTicks new_price_ticks, int new_quantity, TradeSink on_trade);
+
+    // Applies `count` actions in order, exactly as the matching submit/cancel/replace calls
+    // would, writing one ActionResult per action and appending trades to `out_trades`.
+    // Checks that do not depend on book state run first, in passes over the whole batch.
+    void process_batch(const EngineAction* actions,
+                       std::size_t count,
+                       ActionResult* out_results,
+                       std::vector<Trade>& out_trades);
+
+    // Handle-based variants: no order-id lookup. A stale handle is rejected.
+    bool cancel(OrderHandle handle);
+    SubmitResult replace(OrderHandle handle, PriceTicks new_price_ticks, int new_quantity);
+    SubmitResult replace(OrderHandle handle, PriceTicks new_price_ticks, int new_quantity, TradeSink on_trade);
+
     TopOfBook top_of_book() const;
     BookSnapshot depth(std::size_t n_levels) const;
     std::uint64_t last_seq_num() const;
-    std::vector<BookEvent> events_since(std::uint64_t seq_num) const;
-    const std::vector<BookEvent>& event_log() const { return events_; }
+    // Zero-copy view of the retained events after `seq_num`; valid until the next
+    // submit/cancel/replace.
+    EventLog::Range events_since(std::uint64_t seq_num) const { return events_.since(seq_num); }
+    const EventLog& event_log() const { return events_; }
+    EventLogMode event_log_mode() const { return event_log_mode_; }
+    // Appends events evicted from a bounded event log to a spill segment at `path`.
+    bool spill_evicted_events(const std::string& path, std::string& out_error) {
+        return events_.spill_to(path, out_error);
+    }
+    // Flushes the spill segment; false if any evicted event failed to reach it.
+    bool flush_event_spill(std::string& out_error) { return events_.flush_spill(out_error); }
 
     bool has_order(int order_id) const;
-    const OrderBook& bids() const { return bids_; }
-    const OrderBook& asks() const { return asks_; }
+    const BidBook& bids() const { return bids_; }
+    const AskBook& asks() const { return asks_; }
+    const OrderIndex& order_index() const { return order_index_; }
 
 private:
+    // Side-specialised paths: `S` is the side of the incoming or resting order.
+    template <Side S>
+    OrderBook<S>& book();
+    template <Side S>
+    void submit_side(Order& order, SubmitResult& result, TradeSink on_trade);
+    // submit_side() minus the quantity and price-grid checks, which the caller has already
+    // made; the dense span check depends on the book, so it still runs here.
+    template <Side S>
+    void submit_prechecked(Order& order, SubmitResult& result, TradeSink on_trade);
+    SubmitResult replace_prechecked(int order_id,
+                                    PriceTicks new_price_ticks,
+                                    int new_quantity,
+                                    TradeSink on_trade);
+    // `entry` is the order's index entry when the caller already looked it up, or null
+    // when it came in through a handle (its entry is then left to go stale).
+    template <Side S>
+    SubmitResult replace_resting(OrderNodeIndex node,
+                                 const OrderIndex::Entry* entry,
+                                 PriceTicks new_price_ticks,
+                                 int new_quantity,
+                                 TradeSink on_trade);
+    bool validate_replace(PriceTicks new_price_ticks, int new_quantity, SubmitResult& result) const;
+    bool handle_live(const OrderHandle& handle) const;
+
+    bool entry_live(const OrderIndex::Entry& entry) const;
+    // Finds the live entry for `order_id`, dropping a stale one on the way.
+    const OrderIndex::Entry* find_live(int order_id);
+    void purge_stale_entries_before_growth();
+
+    template <typename MakeEvent>
+    void record_event(MakeEvent make_event) {
+        if (event_log_mode_ == EventLogMode::OFF) {
+            ++next_seq_num_;
+            return;
+        }
+        push_event(make_event());
+    }
     void push_event(BookEvent event);
     void push_trade_event(const Trade& trade);
     void push_add_event(const Order& order);
     void push_cancel_event(const Order& order);
     void push_replace_event(const Order& old_order, const Order& new_order);
 
-    OrderBook bids_{Side::BUY};
-    OrderBook asks_{Side::SELL};
-    std::vector<BookEvent> events_;
+    BidBook bids_;
+    AskBook asks_;
+    OrderIndex order_index_;
+    EventLogMode event_log_mode_ = EventLogMode::FULL;
+    EventLog events_;
     std::uint64_t next_seq_num_ = 1;
+    // Index entries left behind by handle-based cancel/replace.
+    std::size_t stale_index_entries_ = 0;
 };
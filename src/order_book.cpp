@@ -2,129 +2,164 @@
 
 #include <cassert>
 
-OrderBook::OrderBook(Side side)
-    : side_(side), comparator_(side), levels_(comparator_) {}
-
-void OrderBook::add(const Order& order) {
-    auto level_it = levels_.find(order.price_ticks);
-    if (level_it == levels_.end()) {
-        level_it = levels_.emplace(order.price_ticks, LevelQueue{}).first;
+template <Side S>
+OrderBook<S>::OrderBook(const OrderBookConfig& config)
+    : backend_(config.ladder),
+      dense_(config.dense_tick_size, config.dense_initial_levels, config.dense_max_levels),
+      pool_(config.initial_order_capacity) {}
+
+template <Side S>
+OrderNodeIndex OrderBook<S>::add(const Order& order) {
+    PriceLevel& level = backend_ == LadderBackend::DENSE ? dense_.level_at(order.price_ticks, pool_)
+                                                         : map_.level_at(order.price_ticks);
+
+    const OrderNodeIndex node = pool_.acquire(order);
+    OrderNode& entry = pool_.node(node);
+    entry.level = &level;
+    if (level.empty()) {
+        level.head = node;
+    } else {
+        pool_.node(level.tail).next = node;
+        entry.prev = level.tail;
     }
-    auto& queue = level_it->second;
-    queue.push_back(order);
-
-    auto order_it = queue.end();
-    --order_it;
-    [[maybe_unused]] const bool inserted =
-        order_index_.emplace(order.id, Locator{level_it, order_it}).second;
-    assert(inserted && "Duplicate order id added to OrderBook");
+    level.tail = node;
+    level.total_quantity += order.quantity;
+    ++level.order_count;
+    return node;
 }
 
-bool OrderBook::cancel(int order_id) {
-    return remove(order_id).has_value();
-}
+template <Side S>
+void OrderBook<S>::unlink(OrderNodeIndex node) {
+    const OrderNode& entry = pool_.node(node);
+    PriceLevel& level = *entry.level;
+    if (entry.prev == kNullOrderNode) {
+        level.head = entry.next;
+    } else {
+        pool_.node(entry.prev).next = entry.next;
+    }
+
+    if (entry.next == kNullOrderNode) {
+        level.tail = entry.prev;
+    } else {
+        pool_.node(entry.next).prev = entry.prev;
+    }
+    level.total_quantity -= entry.order.quantity;
+    --level.order_count;
 
-Order* OrderBook::find_mutable(int order_id) {
-    auto index_it = order_index_.find(order_id);
-    if (index_it == order_index_.end()) {
-        return nullptr;
+    pool_.release(node);
+    if (level.empty()) {
+        with_ladder([&](auto& ladder) { ladder.release(level); });
     }
+}
 
-    return &(*index_it->second.order_it);
+template <Side S>
+Order OrderBook<S>::remove(OrderNodeIndex node) {
+    Order removed = pool_.node(node).order;
+    unlink(node);
+    return removed;
 }
 
-const Order* OrderBook::find(int order_id) const {
-    auto index_it = order_index_.find(order_id);
-    if (index_it == order_index_.end()) {
-        return nullptr;
+template <Side S>
+void OrderBook<S>::consume_best() {
+    if (empty()) {
+        return;
     }
 
-    return &(*index_it->second.order_it);
+    unlink(best_price_level().head);
 }
 
-std::optional<Order> OrderBook::remove(int order_id) {
-    auto index_it = order_index_.find(order_id);
-    if (index_it == order_index_.end()) {
-        return std::nullopt;
-    }
+template <Side S>
+bool OrderBook<S>::fill_best(int quantity) {
+    PriceLevel& level = best_price_level();
+    OrderNode& entry = pool_.node(level.head);
+    assert(quantity > 0 && quantity <= entry.order.quantity && "Fill exceeds best order quantity");
 
-    auto level_it = index_it->second.level_it;
-    auto order_it = index_it->second.order_it;
-    Order removed = *order_it;
-    level_it->second.erase(order_it);
-    if (level_it->second.empty()) {
-        levels_.erase(level_it);
+    entry.order.quantity -= quantity;
+    level.total_quantity -= quantity;
+    if (entry.order.quantity != 0) {
+        return false;
     }
 
-    order_index_.erase(index_it);
-    return removed;
+    unlink(level.head);
+    return true;
 }
 
-void OrderBook::consume_best() {
-    if (levels_.empty()) {
-        return;
-    }
+template <Side S>
+void OrderBook<S>::reduce_quantity(OrderNodeIndex node, int new_quantity) {
+    OrderNode& entry = pool_.node(node);
+    assert(new_quantity > 0 && new_quantity <= entry.order.quantity && "Reduce must shrink the order");
+    entry.level->total_quantity -= entry.order.quantity - new_quantity;
+    entry.order.quantity = new_quantity;
+}
 
-    auto level_it = levels_.begin();
-    auto& queue = level_it->second;
-    if (!queue.empty()) {
-        order_index_.erase(queue.front().id);
-        queue.pop_front();
-    }
+template <Side S>
+bool OrderBook<S>::accepts_price(PriceTicks price_ticks) const {
+    return backend_ != LadderBackend::DENSE || dense_.accepts_price(price_ticks);
+}
 
-    if (queue.empty()) {
-        levels_.erase(level_it);
-    }
+template <Side S>
+bool OrderBook<S>::empty() const {
+    return with_ladder([](const auto& ladder) { return ladder.empty(); });
 }
 
-bool OrderBook::contains(int order_id) const {
-    return order_index_.find(order_id) != order_index_.end();
+template <Side S>
+PriceLevel& OrderBook<S>::best_price_level() {
+    return *with_ladder([](auto& ladder) { return ladder.best(); });
 }
 
-bool OrderBook::empty() const {
-    return levels_.empty();
+template <Side S>
+const PriceLevel& OrderBook<S>::best_price_level() const {
+    return *with_ladder([](const auto& ladder) { return ladder.best(); });
 }
 
-PriceTicks OrderBook::best_price_ticks() const {
-    return levels_.begin()->first;
+template <Side S>
+PriceTicks OrderBook<S>::best_price_ticks() const {
+    return best_price_level().price_ticks;
 }
 
-Order& OrderBook::best_order() {
-    return levels_.begin()->second.front();
+template <Side S>
+const Order& OrderBook<S>::best_order() const {
+    return pool_.node(best_price_level().head).order;
 }
 
-const Order& OrderBook::best_order() const {
-    return levels_.begin()->second.front();
+template <Side S>
+std::optional<BookLevel> OrderBook<S>::best_level() const {
+    if (empty()) {
+        return std::nullopt;
+    }
+
+    const PriceLevel& level = best_price_level();
+    return BookLevel{level.price_ticks, level.total_quantity, level.order_count};
 }
 
-std::vector<BookLevel> OrderBook::depth(std::size_t n_levels) const {
+template <Side S>
+std::vector<BookLevel> OrderBook<S>::depth(std::size_t n_levels) const {
     std::vector<BookLevel> levels;
     if (n_levels == 0) {
         return levels;
     }
 
-    const std::size_t max_levels = n_levels < levels_.size() ? n_levels : levels_.size();
-    levels.reserve(max_levels);
+    const std::size_t available = level_count();
+    levels.reserve(n_levels < available ? n_levels : available);
 
-    for (const auto& [price_ticks, queue] : levels_) {
-        int level_quantity = 0;
-        for (const auto& order : queue) {
-            level_quantity += order.quantity;
-        }
-
-        levels.push_back(BookLevel{price_ticks, level_quantity});
-        if (levels.size() == n_levels) {
-            break;
-        }
-    }
+    with_ladder([&](const auto& ladder) {
+        ladder.visit(n_levels, [&](const PriceLevel& level) {
+            levels.push_back(BookLevel{level.price_ticks, level.total_quantity, level.order_count});
+        });
+    });
 
     return levels;
 }
 
-std::size_t OrderBook::order_count() const {
-    return order_index_.size();
+template <Side S>
+std::size_t OrderBook<S>::order_count() const {
+    return pool_.live_count();
 }
 
-Side OrderBook::side() const {
-    return side_;
+template <Side S>
+std::size_t OrderBook<S>::level_count() const {
+    return with_ladder([](const auto& ladder) { return ladder.level_count(); });
 }
+
+template class OrderBook<Side::BUY>;
+template class OrderBook<Side::SELL>;
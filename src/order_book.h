@@ -1,53 +1,108 @@
 #pragma once
 
 #include <cstddef>
-#include <list>
-#include <map>
 #include <optional>
-#include <unordered_map>
 #include <vector>
 
+#include "order_pool.h"
+#include "price_ladder.h"
 #include "types.h"
 
+struct OrderBookConfig {
+    LadderBackend ladder = LadderBackend::MAP;
+    // Dense ladder only: price increment of one level, and the starting window size.
+    PriceTicks dense_tick_size = 1;
+    std::size_t dense_initial_levels = 1024;
+    // Dense ladder only: widest band of resting prices one side may span, in levels. A limit
+    // order that would rest past it is rejected with INVALID_PRICE if nothing filled, and
+    // otherwise has its remainder dropped; marketable orders that fill in full are unaffected.
+    std::size_t dense_max_levels = std::size_t{1} << 20;
+    std::size_t initial_order_capacity = 0;
+};
+
+// One side of the book, specialised on that side at compile time. Resting orders are
+// addressed by their pool node; mapping order ids to nodes is the owner's job (see OrderIndex).
+template <Side S>
 class OrderBook {
 public:
-    explicit OrderBook(Side side);
+    explicit OrderBook(const OrderBookConfig& config = OrderBookConfig{});
 
-    void add(const Order& order);
-    bool cancel(int order_id);
+    OrderNodeIndex add(const Order& order);
+    Order remove(OrderNodeIndex node);
     void consume_best();
+    // Executes `quantity` against the best order; returns true when that fill consumed it.
+    bool fill_best(int quantity);
+    // Consumes every order at the best level: `on_fill(order)` sees each one in queue order,
+    // then the nodes go back to the pool as one chain and the level is dropped once.
+    // Returns the level's total quantity.
+    template <typename OnFill>
+    int consume_best_level(OnFill&& on_fill) {
+        PriceLevel& level = best_price_level();
+        for (OrderNodeIndex node = level.head; node != kNullOrderNode; node = pool_.node(node).next) {
+            on_fill(static_cast<const Order&>(pool_.node(node).order));
+        }
 
-    bool contains(int order_id) const;
-    Order* find_mutable(int order_id);
-    const Order* find(int order_id) const;
-    std::optional<Order> remove(int order_id);
+        const int consumed_quantity = level.total_quantity;
+        pool_.release_chain(level.head, level.tail, static_cast<std::size_t>(level.order_count));
+        level.head = kNullOrderNode;
+        level.tail = kNullOrderNode;
+        level.total_quantity = 0;
+        level.order_count = 0;
+        with_ladder([&](auto& ladder) { ladder.release(level); });
+        return consumed_quantity;
+    }
+    // Shrinks a resting order in place, keeping its queue position.
+    void reduce_quantity(OrderNodeIndex node, int new_quantity);
+
+    const Order& order_at(OrderNodeIndex node) const { return pool_.node(node).order; }
+    std::uint32_t generation_of(OrderNodeIndex node) const { return pool_.node(node).generation; }
+    // True when `node` still holds the order it held at `generation`.
+    bool holds(OrderNodeIndex node, std::uint32_t generation) const { return pool_.is_live(node, generation); }
+    bool accepts_price(PriceTicks price_ticks) const;
+    // False when resting at `price_ticks` would stretch a dense ladder past its maximum span.
+    bool fits_price(PriceTicks price_ticks) const {
+        return backend_ != LadderBackend::DENSE || dense_.fits_price(price_ticks);
+    }
+    // Limit prices must be a multiple of this (1 when any price is accepted).
+    PriceTicks price_grid_ticks() const { return backend_ == LadderBackend::DENSE ? dense_.tick_size() : 1; }
     bool empty() const;
     PriceTicks best_price_ticks() const;
-    Order& best_order();
     const Order& best_order() const;
+    std::optional<BookLevel> best_level() const;
+    int best_level_quantity() const { return best_price_level().total_quantity; }
     std::vector<BookLevel> depth(std::size_t n_levels) const;
     std::size_t order_count() const;
-    Side side() const;
+    std::size_t level_count() const;
+    static constexpr Side side() { return S; }
+    LadderBackend ladder_backend() const { return backend_; }
+    const OrderPool& order_pool() const { return pool_; }
 
 private:
-    struct PriceComparator {
-        explicit PriceComparator(Side side) : side(side) {}
-        bool operator()(PriceTicks lhs, PriceTicks rhs) const {
-            return side == Side::BUY ? lhs > rhs : lhs < rhs;
+    template <typename Fn>
+    decltype(auto) with_ladder(Fn&& fn) {
+        if (backend_ == LadderBackend::DENSE) {
+            return fn(dense_);
         }
-        Side side;
-    };
+        return fn(map_);
+    }
 
-    using LevelQueue = std::list<Order>;
-    using Levels = std::map<PriceTicks, LevelQueue, PriceComparator>;
+    template <typename Fn>
+    decltype(auto) with_ladder(Fn&& fn) const {
+        if (backend_ == LadderBackend::DENSE) {
+            return fn(dense_);
+        }
+        return fn(map_);
+    }
 
-    struct Locator {
-        Levels::iterator level_it;
-        LevelQueue::iterator order_it;
-    };
+    PriceLevel& best_price_level();
+    const PriceLevel& best_price_level() const;
+    void unlink(OrderNodeIndex node);
 
-    Side side_;
-    PriceComparator comparator_;
-    Levels levels_;
-    std::unordered_map<int, Locator> order_index_;
+    LadderBackend backend_;
+    MapLadder<S> map_;
+    DenseLadder<S> dense_;
+    OrderPool pool_;
 };
+
+using BidBook = OrderBook<Side::BUY>;
+using AskBook = OrderBook<Side::SELL>;
@@ -0,0 +1,347 @@
+#include "order_flow_generator.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string_view>
+
+#include "csv_writer.h"
+#include "replay_binary.h"
+
+namespace {
+
+bool is_fraction(double value) {
+    return value >= 0.0 && value <= 1.0;
+}
+
+// log2 of a mantissa in [1, 2) with 62 fraction bits, to `fraction_bits` bits, from
+// integer arithmetic alone: each bit comes from squaring the mantissa, so every platform
+// gets the same bits.
+std::uint64_t log2_mantissa(std::uint64_t mantissa, unsigned fraction_bits) {
+    std::uint64_t log2 = 0;
+    for (unsigned bit = 0; bit < fraction_bits; ++bit) {
+        __extension__ const unsigned __int128 square = static_cast<unsigned __int128>(mantissa) * mantissa;
+        mantissa = static_cast<std::uint64_t>(square >> 62);
+        log2 <<= 1;
+        if (mantissa >= (std::uint64_t{1} << 63)) {
+            mantissa >>= 1;
+            log2 |= 1;
+        }
+    }
+    return log2;
+}
+
+// -log2(x / 2^64) for x > 0, with `fraction_bits` bits after the point; the integer part is
+// a leading-zero count.
+std::uint64_t neg_log2(std::uint64_t x, unsigned fraction_bits) {
+    const auto leading_zeros = static_cast<unsigned>(__builtin_clzll(x));
+    return ((std::uint64_t{leading_zeros} + 1) << fraction_bits) -
+           log2_mantissa((x << leading_zeros) >> 1, fraction_bits);
+}
+
+// Draws take -log2 of a uniform with kDrawBits fraction bits; per-config constants get
+// kDrawBits + kConstantExtraBits, so ratios near 1 keep their precision.
+constexpr unsigned kDrawBits = 32;
+constexpr unsigned kConstantExtraBits = 16;
+
+// Draws interpolate log2 of the mantissa between 1024 points instead of squaring per bit,
+// within 2e-7 of the exact value; the table comes from log2_mantissa, so it is integer too.
+constexpr unsigned kLog2TableBits = 10;
+
+std::uint64_t fast_neg_log2(std::uint64_t x) {
+    static const std::vector<std::uint64_t> table = [] {
+        std::vector<std::uint64_t> points((std::size_t{1} << kLog2TableBits) + 1);
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            points[i] = i + 1 == points.size()
+                            ? std::uint64_t{1} << kDrawBits
+                            : log2_mantissa((std::uint64_t{1} << 62) | (std::uint64_t{i} << (62 - kLog2TableBits)),
+                                            kDrawBits);
+        }
+        return points;
+    }();
+
+    const auto leading_zeros = static_cast<unsigned>(__builtin_clzll(x));
+    const std::uint64_t mantissa = x << leading_zeros;
+    const std::size_t index = (mantissa >> (63 - kLog2TableBits)) & ((std::size_t{1} << kLog2TableBits) - 1);
+    const std::uint64_t weight = (mantissa >> (63 - kLog2TableBits - 32)) & 0xFFFFFFFFu;
+    const std::uint64_t log2 = table[index] + (((table[index + 1] - table[index]) * weight) >> 32);
+    return ((std::uint64_t{leading_zeros} + 1) << kDrawBits) - log2;
+}
+
+// -log2(ratio) for ratio in (0, 1), with kDrawBits + kConstantExtraBits fraction bits and
+// never 0. Scaling a double by 2^64 is exact, so the input is the same everywhere.
+std::uint64_t neg_log2_ratio(double ratio) {
+    const auto fixed = static_cast<std::uint64_t>(ratio * 0x1.0p64);
+    if (fixed == 0) {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    return std::max<std::uint64_t>(1, neg_log2(fixed, kDrawBits + kConstantExtraBits));
+}
+
+void write_csv_row(CsvWriter& output, const ReplayRow& row) {
+    output.put_int(row.ts_ns);
+    output.put(',');
+    output.put_int(row.seq);
+    output.put(',');
+    if (row.action == ReplayAction::CANCEL) {
+        output.put("CANCEL,");
+        output.put_int(row.order_id);
+        output.put(",,,,,,,,\n");
+        return;
+    }
+    if (row.action == ReplayAction::REPLACE) {
+        output.put("REPLACE,");
+        output.put_int(row.order_id);
+        output.put(",,,,,,");
+        output.put_price(row.price_ticks);
+        output.put(',');
+        output.put_int(row.quantity);
+        output.put(",\n");
+        return;
+    }
+
+    output.put("NEW,");
+    output.put_int(row.order_id);
+    output.put(row.side == Side::BUY ? ",BUY," : ",SELL,");
+    if (row.type == OrderType::MARKET) {
+        output.put("MARKET,,");
+    } else {
+        output.put("LIMIT,");
+        output.put_price(row.price_ticks);
+        output.put(',');
+    }
+    output.put_int(row.quantity);
+    output.put(row.tif == TimeInForce::IOC ? ",IOC,,,\n" : ",GTC,,,\n");
+}
+
+}  // namespace
+
+bool validate_order_flow_config(const OrderFlowConfig& config, std::string& out_error) {
+    if (config.rows > static_cast<std::size_t>(INT_MAX)) {
+        out_error = "rows must be at most " + std::to_string(INT_MAX) + " so every order id fits";
+        return false;
+    }
+    if (!(config.arrivals_per_second >= 1.0) || !std::isfinite(config.arrivals_per_second)) {
+        out_error = "arrival rate must be at least 1 per second";
+        return false;
+    }
+    if (!is_fraction(config.cancel_fraction) || !is_fraction(config.replace_fraction) ||
+        config.cancel_fraction + config.replace_fraction > 1.0) {
+        out_error = "cancel and replace fractions must be in [0, 1] and sum to at most 1";
+        return false;
+    }
+    if (!is_fraction(config.marketable_fraction) || !is_fraction(config.market_order_fraction) ||
+        !is_fraction(config.mid_move_probability)) {
+        out_error = "marketable, market order and mid move fractions must be in [0, 1]";
+        return false;
+    }
+    if (config.tick_size_ticks <= 0 || config.start_mid_ticks <= 0) {
+        out_error = "tick size and starting mid must be positive";
+        return false;
+    }
+    if (!(config.level_decay >= 0.0 && config.level_decay < 1.0) || config.max_levels <= 0) {
+        out_error = "level decay must be in [0, 1) and max levels positive";
+        return false;
+    }
+    if (!(config.mean_quantity >= 1.0) || !std::isfinite(config.mean_quantity) || config.max_quantity <= 0) {
+        out_error = "mean quantity must be at least 1 and max quantity positive";
+        return false;
+    }
+    if (config.max_live_orders == 0) {
+        out_error = "max live orders must be positive";
+        return false;
+    }
+    return true;
+}
+
+OrderFlowGenerator::OrderFlowGenerator(const OrderFlowConfig& config)
+    : config_(config),
+      state_(config.seed),
+      mid_level_(config.start_mid_ticks / config.tick_size_ticks),
+      // Keeps the deepest buy level at one tick or more.
+      min_mid_level_(static_cast<std::int64_t>(config.max_levels) + 2) {
+    mid_level_ = std::max(mid_level_, min_mid_level_);
+    if (config.level_decay > 0.0) {
+        level_log_ = neg_log2_ratio(config.level_decay);
+    }
+    const double extra_mean = config.mean_quantity - 1.0;
+    if (extra_mean > 0.0) {
+        quantity_log_ = neg_log2_ratio(extra_mean / (extra_mean + 1.0));
+    }
+    // Mean gap times ln 2, in nanoseconds per unit of -log2(u), with kDrawBits fraction bits.
+    // Under 2^32 ns for any rate validate_order_flow_config accepts.
+    gap_scale_ = static_cast<std::uint64_t>(0.6931471805599453 * 1e9 / config.arrivals_per_second * 0x1.0p32);
+    live_.reserve(std::min<std::size_t>(config.max_live_orders, config.rows));
+}
+
+// SplitMix64: full period, and one add plus three multiply/xor-shift rounds per draw.
+std::uint64_t OrderFlowGenerator::next_u64() {
+    std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in (0, 1). The conversion and scaling are exact, so comparisons against it come
+// out the same everywhere.
+double OrderFlowGenerator::next_unit() {
+    return (static_cast<double>(next_u64() >> 11) + 0.5) * 0x1.0p-53;
+}
+
+// -log2 of a uniform in (0, 1], with kDrawBits fraction bits: the inverse CDF of an
+// exponential, up to the scale the caller applies.
+std::uint64_t OrderFlowGenerator::next_neg_log2() {
+    return fast_neg_log2(std::max<std::uint64_t>(next_u64(), 1));
+}
+
+// Geometric on {0, 1, ...} where each value is `ratio` times as likely as the one before,
+// given -log2(ratio) from neg_log2_ratio: floor(log(u) / log(ratio)) in fixed point.
+std::uint64_t OrderFlowGenerator::next_geometric(std::uint64_t ratio_log) {
+    return (next_neg_log2() << kConstantExtraBits) / ratio_log;
+}
+
+int OrderFlowGenerator::next_levels_away() {
+    if (level_log_ == 0) {
+        return 0;
+    }
+    const std::uint64_t levels = next_geometric(level_log_);
+    return static_cast<int>(std::min<std::uint64_t>(levels, static_cast<std::uint64_t>(config_.max_levels - 1)));
+}
+
+int OrderFlowGenerator::next_quantity() {
+    if (quantity_log_ == 0) {
+        return 1;
+    }
+    // Geometric on {0, 1, ...} with mean mean_quantity - 1.
+    const std::uint64_t extra = next_geometric(quantity_log_);
+    return 1 + static_cast<int>(std::min<std::uint64_t>(extra, static_cast<std::uint64_t>(config_.max_quantity - 1)));
+}
+
+PriceTicks OrderFlowGenerator::level_price(std::int64_t level) const {
+    return static_cast<PriceTicks>(level) * config_.tick_size_ticks;
+}
+
+void OrderFlowGenerator::remember(const LiveOrder& order) {
+    if (live_.size() < config_.max_live_orders) {
+        live_.push_back(order);
+        return;
+    }
+    live_[next_u64() % live_.size()] = order;
+}
+
+ReplayRow OrderFlowGenerator::next() {
+    ReplayRow row;
+    // Exponential gap in nanoseconds with 32 fraction bits; the fraction carries over.
+    __extension__ const unsigned __int128 gap =
+        static_cast<unsigned __int128>(next_neg_log2()) * gap_scale_ >> kDrawBits;
+    const std::uint64_t gap_fraction = elapsed_fraction_ + static_cast<std::uint32_t>(gap);
+    elapsed_ns_ += static_cast<std::uint64_t>(gap >> 32) + (gap_fraction >> 32);
+    elapsed_fraction_ = static_cast<std::uint32_t>(gap_fraction);
+    row.ts_ns = config_.start_ts_ns + elapsed_ns_;
+    row.seq = stats_.rows;
+    row.row_index = static_cast<std::uint32_t>(stats_.rows);
+    ++stats_.rows;
+
+    if (next_unit() < config_.mid_move_probability) {
+        mid_level_ = std::max(min_mid_level_, mid_level_ + ((next_u64() & 1) != 0 ? 1 : -1));
+    }
+
+    const double action = next_unit();
+    if (!live_.empty() && action < config_.cancel_fraction + config_.replace_fraction) {
+        const std::size_t pick = next_u64() % live_.size();
+        const LiveOrder order = live_[pick];
+        row.order_id = order.order_id;
+        if (action < config_.cancel_fraction) {
+            row.action = ReplayAction::CANCEL;
+            live_[pick] = live_.back();
+            live_.pop_back();
+            ++stats_.cancels;
+            return row;
+        }
+        row.action = ReplayAction::REPLACE;
+        const std::int64_t away = 1 + next_levels_away();
+        row.price_ticks = level_price(order.side == Side::BUY ? mid_level_ - away : mid_level_ + away);
+        row.quantity = next_quantity();
+        ++stats_.replaces;
+        return row;
+    }
+
+    row.action = ReplayAction::NEW;
+    row.order_id = next_order_id_++;
+    row.side = (next_u64() & 1) != 0 ? Side::BUY : Side::SELL;
+    row.quantity = next_quantity();
+    ++stats_.new_orders;
+
+    const std::int64_t away = 1 + next_levels_away();
+    if (next_unit() < config_.marketable_fraction) {
+        // Priced through the opposite touch, so it takes liquidity and never rests.
+        ++stats_.marketable_orders;
+        row.tif = TimeInForce::IOC;
+        if (next_unit() < config_.market_order_fraction) {
+            row.type = OrderType::MARKET;
+            return row;
+        }
+        row.price_ticks = level_price(row.side == Side::BUY ? mid_level_ + away : mid_level_ - away);
+        return row;
+    }
+
+    row.price_ticks = level_price(row.side == Side::BUY ? mid_level_ - away : mid_level_ + away);
+    remember({row.order_id, row.side});
+    return row;
+}
+
+ReplayFileFormat replay_file_format_for(const std::string& path) {
+    const std::string_view extension = ".merb";
+    const bool is_binary = path.size() >= extension.size() &&
+                           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    return is_binary ? ReplayFileFormat::BINARY : ReplayFileFormat::CSV;
+}
+
+bool write_order_flow(const std::string& path,
+                      const OrderFlowConfig& config,
+                      ReplayFileFormat format,
+                      OrderFlowStats& out_stats,
+                      std::string& out_error) {
+    out_stats = OrderFlowStats{};
+    if (!validate_order_flow_config(config, out_error)) {
+        return false;
+    }
+
+    CsvWriter output;
+    if (!output.open(path)) {
+        out_error = "failed to open generated replay file for writing: " + path;
+        return false;
+    }
+
+    OrderFlowGenerator generator(config);
+    if (format == ReplayFileFormat::CSV) {
+        output.put("ts_ns,seq,action,order_id,side,type,price,qty,tif,new_price,new_qty,notes\n");
+        while (!generator.done()) {
+            write_csv_row(output, generator.next());
+        }
+    } else {
+        // The row count is known up front and rows come out in replay order, so the header
+        // is final before the first record.
+        ReplayBinaryHeader header{};
+        std::memcpy(header.magic, kReplayBinaryMagic, sizeof(header.magic));
+        header.version = kReplayBinaryVersion;
+        header.record_size = sizeof(ReplayBinaryRecord);
+        header.byte_order = kReplayBinaryByteOrder;
+        header.flags = kReplayBinarySorted;
+        header.row_count = config.rows;
+        output.put(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+        while (!generator.done()) {
+            const ReplayBinaryRecord record = to_replay_binary_record(generator.next());
+            output.put(std::string_view(reinterpret_cast<const char*>(&record), sizeof(record)));
+        }
+    }
+
+    out_stats = generator.stats();
+    if (!output.close()) {
+        out_error = "failed while writing generated replay file: " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "replay_rows.h"
+
+// Synthetic order flow around a random-walk mid. Every draw comes from one seeded 64-bit
+// generator, and the exponential and geometric samplers use integer fixed-point logarithms
+// rather than libm, so a config produces the same rows on any platform with IEEE doubles.
+struct OrderFlowConfig {
+    std::uint64_t seed = 1;
+    std::size_t rows = 1000000;
+    std::uint64_t start_ts_ns = 0;
+    // Mean arrivals per second, at least 1; gaps between rows are exponential (Poisson
+    // arrivals).
+    double arrivals_per_second = 100000.0;
+    // Action mix; NEW takes the rest. A CANCEL or REPLACE drawn while no generated order is
+    // resting becomes a NEW instead.
+    double cancel_fraction = 0.30;
+    double replace_fraction = 0.10;
+    // NEW orders priced through the touch instead of resting behind it.
+    double marketable_fraction = 0.05;
+    // Marketable orders sent as MARKET; the rest are IOC limits.
+    double market_order_fraction = 0.5;
+    PriceTicks start_mid_ticks = price_to_ticks(100.0);
+    PriceTicks tick_size_ticks = price_to_ticks(0.01);
+    // Chance per row that the mid moves one tick, up or down with equal odds.
+    double mid_move_probability = 0.01;
+    // Levels from the touch are geometric: each level is this much as likely as the one
+    // inside it. Capped at max_levels.
+    double level_decay = 0.7;
+    int max_levels = 50;
+    // Quantities are 1 plus a geometric draw with this mean, capped at max_quantity.
+    double mean_quantity = 10.0;
+    int max_quantity = 1000;
+    // Resting orders remembered for CANCEL and REPLACE targets; beyond this a random one is
+    // forgotten, so memory stays flat on long runs.
+    std::size_t max_live_orders = std::size_t{1} << 20;
+};
+
+struct OrderFlowStats {
+    std::size_t rows = 0;
+    std::size_t new_orders = 0;
+    std::size_t cancels = 0;
+    std::size_t replaces = 0;
+    std::size_t marketable_orders = 0;
+};
+
+// Returns false with a message naming the first out-of-range field.
+bool validate_order_flow_config(const OrderFlowConfig& config, std::string& out_error);
+
+// Produces rows one at a time, already in replay order with row_index ascending. The
+// config must pass validate_order_flow_config.
+class OrderFlowGenerator {
+public:
+    explicit OrderFlowGenerator(const OrderFlowConfig& config);
+
+    bool done() const { return stats_.rows >= config_.rows; }
+    ReplayRow next();
+
+    const OrderFlowStats& stats() const { return stats_; }
+
+private:
+    struct LiveOrder {
+        int order_id;
+        Side side;
+    };
+
+    std::uint64_t next_u64();
+    double next_unit();
+    std::uint64_t next_neg_log2();
+    std::uint64_t next_geometric(std::uint64_t ratio_log);
+    int next_levels_away();
+    int next_quantity();
+    PriceTicks level_price(std::int64_t level) const;
+    void remember(const LiveOrder& order);
+
+    OrderFlowConfig config_;
+    std::uint64_t state_;
+    // -log2 of level_decay and of the quantity ratio in fixed point; 0 when the draw is
+    // always 0.
+    std::uint64_t level_log_ = 0;
+    std::uint64_t quantity_log_ = 0;
+    std::uint64_t gap_scale_ = 0;
+    std::uint64_t elapsed_ns_ = 0;
+    std::uint32_t elapsed_fraction_ = 0;
+    // Mid in ticks of tick_size_ticks; the touch is one tick either side of it.
+    std::int64_t mid_level_;
+    std::int64_t min_mid_level_;
+    int next_order_id_ = 1;
+    std::vector<LiveOrder> live_;
+    OrderFlowStats stats_;
+};
+
+enum class ReplayFileFormat {
+    CSV,
+    BINARY,
+};
+
+// BINARY for paths ending in ".merb", CSV otherwise.
+ReplayFileFormat replay_file_format_for(const std::string& path);
+
+// Streams config.rows generated rows to `path` as a replay CSV or a sorted .merb file,
+// without holding them in memory.
+bool write_order_flow(const std::string& path,
+                      const OrderFlowConfig& config,
+                      ReplayFileFormat format,
+                      OrderFlowStats& out_stats,
+                      std::string& out_error);
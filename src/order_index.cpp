@@ -0,0 +1,102 @@
+#include "order_index.h"
+
+#include <utility>
+
+namespace {
+
+constexpr std::size_t kMinCapacity = 16;
+
+std::size_t round_up_pow2(std::size_t value) {
+    std::size_t capacity = kMinCapacity;
+    while (capacity < value) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+}  // namespace
+
+OrderIndex::OrderIndex(std::size_t initial_capacity) {
+    // Keep the load factor at or below one half.
+    rehash(round_up_pow2(initial_capacity * 2));
+}
+
+const OrderIndex::Entry* OrderIndex::find(int order_id) const {
+    for (std::size_t slot = home_slot(order_id);; slot = (slot + 1) & mask_) {
+        const Entry& entry = slots_[slot];
+        if (!entry.occupied) {
+            return nullptr;
+        }
+        if (entry.order_id == order_id) {
+            return &entry;
+        }
+    }
+}
+
+bool OrderIndex::insert(int order_id, Side side, OrderNodeIndex node, std::uint32_t generation) {
+    if ((size_ + 1) * 2 > slots_.size()) {
+        rehash(slots_.size() * 2);
+    }
+
+    std::size_t slot = home_slot(order_id);
+    while (slots_[slot].occupied) {
+        if (slots_[slot].order_id == order_id) {
+            return false;
+        }
+        slot = (slot + 1) & mask_;
+    }
+
+    slots_[slot] = Entry{order_id, node, generation, side, true};
+    ++size_;
+    return true;
+}
+
+void OrderIndex::erase(const Entry* entry) {
+    erase_slot(static_cast<std::size_t>(entry - slots_.data()));
+}
+
+bool OrderIndex::erase(int order_id) {
+    const Entry* entry = find(order_id);
+    if (entry == nullptr) {
+        return false;
+    }
+    erase(entry);
+    return true;
+}
+
+void OrderIndex::erase_slot(std::size_t slot) {
+    // Backward-shift deletion: pull later members of the cluster into the hole
+    // whenever the hole lies on their probe path.
+    std::size_t hole = slot;
+    for (std::size_t next = (hole + 1) & mask_; slots_[next].occupied; next = (next + 1) & mask_) {
+        const std::size_t home = home_slot(slots_[next].order_id);
+        const std::size_t distance_to_next = (next - home) & mask_;
+        const std::size_t distance_to_hole = (hole - home) & mask_;
+        if (distance_to_hole <= distance_to_next) {
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+    }
+
+    slots_[hole].occupied = false;
+    --size_;
+}
+
+void OrderIndex::rehash(std::size_t new_capacity) {
+    std::vector<Entry> old_slots(new_capacity);
+    old_slots.swap(slots_);
+    ++growth_count_;
+
+    mask_ = new_capacity - 1;
+    shift_ = 64;
+    for (std::size_t bits = new_capacity; bits > 1; bits >>= 1) {
+        --shift_;
+    }
+    size_ = 0;
+
+    for (const Entry& entry : old_slots) {
+        if (entry.occupied) {
+            insert(entry.order_id, entry.side, entry.node, entry.generation);
+        }
+    }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "order_pool.h"
+#include "types.h"
+
+// Engine-wide map from order id to the side and pool node of a resting order.
+// Open addressing with linear probing over a flat power-of-two table; deletion
+// shifts the following cluster back, so there are no tombstones.
+//
+// Entries carry the node generation they were inserted with. An order removed through
+// its OrderHandle leaves its entry behind; the owner recognises such stale entries by
+// generation and drops them lazily or in bulk with purge().
+class OrderIndex {
+public:
+    struct Entry {
+        int order_id = 0;
+        OrderNodeIndex node = kNullOrderNode;
+        std::uint32_t generation = 0;
+        Side side = Side::BUY;
+        bool occupied = false;
+    };
+
+    explicit OrderIndex(std::size_t initial_capacity = 0);
+
+    const Entry* find(int order_id) const;
+    // Returns false (and leaves the table untouched) when the id is already present.
+    bool insert(int order_id, Side side, OrderNodeIndex node, std::uint32_t generation = 0);
+    // Removes an entry previously returned by find(), without probing again.
+    void erase(const Entry* entry);
+    bool erase(int order_id);
+
+    // True when the next insert would grow the table.
+    bool at_growth_threshold() const { return (size_ + 1) * 2 > slots_.size(); }
+    // Rebuilds the table in place keeping only entries for which `keep(entry)` is true.
+    // Returns the number of entries dropped.
+    template <typename Keep>
+    std::size_t purge(Keep&& keep) {
+        // Work from a reused copy so repeated purges at one capacity do not allocate.
+        if (purge_scratch_.capacity() < slots_.size()) {
+            ++growth_count_;
+        }
+        purge_scratch_.assign(slots_.begin(), slots_.end());
+        for (Entry& entry : slots_) {
+            entry.occupied = false;
+        }
+
+        const std::size_t old_size = size_;
+        size_ = 0;
+        for (const Entry& entry : purge_scratch_) {
+            if (entry.occupied && keep(entry)) {
+                insert(entry.order_id, entry.side, entry.node, entry.generation);
+            }
+        }
+        return old_size - size_;
+    }
+
+    std::size_t size() const { return size_; }
+    std::size_t capacity() const { return slots_.size(); }
+    // Times the table or its purge scratch has been (re)allocated.
+    std::size_t growth_count() const { return growth_count_; }
+
+private:
+    std::size_t home_slot(int order_id) const {
+        // Fibonacci hashing spreads sequential ids across the table.
+        const auto key = static_cast<std::uint64_t>(static_cast<std::uint32_t>(order_id));
+        return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+    void rehash(std::size_t new_capacity);
+    void erase_slot(std::size_t slot);
+
+    std::vector<Entry> slots_;
+    std::vector<Entry> purge_scratch_;
+    std::size_t mask_ = 0;
+    unsigned shift_ = 64;
+    std::size_t size_ = 0;
+    std::size_t growth_count_ = 0;
+};
@@ -0,0 +1,75 @@
+#include "order_pool.h"
+
+#include <cassert>
+#include <limits>
+
+OrderPool::OrderPool(std::size_t initial_capacity) {
+    while (capacity() < initial_capacity) {
+        grow();
+    }
+}
+
+OrderNodeIndex OrderPool::acquire(const Order& order) {
+    if (free_head_ == kNullOrderNode) {
+        grow();
+    }
+
+    const OrderNodeIndex index = free_head_;
+    OrderNode& slot = node(index);
+    free_head_ = slot.next;
+
+    slot.order = order;
+    slot.prev = kNullOrderNode;
+    slot.next = kNullOrderNode;
+    slot.level = nullptr;
+    ++live_count_;
+    return index;
+}
+
+void OrderPool::release(OrderNodeIndex index) {
+    assert(live_count_ > 0 && "Release on an empty OrderPool");
+    OrderNode& slot = node(index);
+    slot.prev = kNullOrderNode;
+    slot.next = free_head_;
+    slot.level = nullptr;
+    ++slot.generation;
+    free_head_ = index;
+    --live_count_;
+}
+
+void OrderPool::release_chain(OrderNodeIndex first, OrderNodeIndex last, std::size_t count) {
+    assert(live_count_ >= count && "Releasing more nodes than are live");
+    for (OrderNodeIndex index = first;; index = node(index).next) {
+        ++node(index).generation;
+        if (index == last) {
+            break;
+        }
+    }
+    node(last).next = free_head_;
+    free_head_ = first;
+    live_count_ -= count;
+}
+
+std::size_t OrderPool::capacity() const {
+    return chunks_.size() * kChunkSize;
+}
+
+void OrderPool::grow() {
+    const std::size_t first = capacity();
+    assert(first + kChunkSize <= std::numeric_limits<OrderNodeIndex>::max() &&
+           "OrderPool exhausted node index space");
+
+    if (chunks_.size() == chunks_.capacity()) {
+        ++growth_count_;
+    }
+    chunks_.push_back(std::make_unique<OrderNode[]>(kChunkSize));
+    ++growth_count_;
+
+    // Thread the new chunk onto the free list so the lowest index is handed out first.
+    OrderNode* chunk = chunks_.back().get();
+    for (std::size_t i = 0; i < kChunkSize; ++i) {
+        const bool last = i + 1 == kChunkSize;
+        chunk[i].next = last ? free_head_ : static_cast<OrderNodeIndex>(first + i + 1);
+    }
+    free_head_ = static_cast<OrderNodeIndex>(first);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "types.h"
+
+using OrderNodeIndex = std::uint32_t;
+constexpr OrderNodeIndex kNullOrderNode = 0xFFFFFFFFu;
+
+struct PriceLevel;
+
+// One resting order plus the intrusive links of its price-level queue.
+// Free nodes reuse `next` as the free-list link. `generation` changes every time the
+// node is released, so (index, generation) names one resting order for its lifetime.
+struct OrderNode {
+    Order order{};
+    OrderNodeIndex prev = kNullOrderNode;
+    OrderNodeIndex next = kNullOrderNode;
+    std::uint32_t generation = 0;
+    PriceLevel* level = nullptr;
+};
+
+// Head of the intrusive FIFO of pool nodes resting at one price, plus running
+// aggregates of the orders queued behind it.
+struct PriceLevel {
+    PriceTicks price_ticks = 0;
+    OrderNodeIndex head = kNullOrderNode;
+    OrderNodeIndex tail = kNullOrderNode;
+    int total_quantity = 0;
+    int order_count = 0;
+
+    bool empty() const { return head == kNullOrderNode; }
+};
+
+// Slab of order nodes addressed by index. Storage grows in fixed-size chunks so
+// node addresses stay stable, and released nodes are recycled through a free list,
+// so steady-state acquire/release never touches the heap.
+class OrderPool {
+public:
+    explicit OrderPool(std::size_t initial_capacity = 0);
+
+    OrderNodeIndex acquire(const Order& order);
+    void release(OrderNodeIndex index);
+    // Returns a whole linked run of `count` nodes (first..last via `next`) to the free
+    // list with a single splice. Stale prev/level fields are left for acquire() to reset.
+    void release_chain(OrderNodeIndex first, OrderNodeIndex last, std::size_t count);
+
+    OrderNode& node(OrderNodeIndex index) {
+        return chunks_[index >> kChunkShift][index & kChunkMask];
+    }
+    const OrderNode& node(OrderNodeIndex index) const {
+        return chunks_[index >> kChunkShift][index & kChunkMask];
+    }
+
+    // True when `index` is a live node that has not been released since it had `generation`.
+    bool is_live(OrderNodeIndex index, std::uint32_t generation) const {
+        if (index >= capacity()) {
+            return false;
+        }
+        const OrderNode& slot = node(index);
+        return slot.generation == generation && slot.level != nullptr;
+    }
+
+    std::size_t capacity() const;
+    std::size_t live_count() const { return live_count_; }
+    // Times the pool has allocated node chunks or grown its chunk table. Only the pool's
+    // own storage is counted, not allocations elsewhere in the book.
+    std::size_t growth_count() const { return growth_count_; }
+
+private:
+    static constexpr std::size_t kChunkShift = 10;
+    static constexpr std::size_t kChunkSize = std::size_t{1} << kChunkShift;
+    static constexpr std::size_t kChunkMask = kChunkSize - 1;
+
+    void grow();
+
+    std::vector<std::unique_ptr<OrderNode[]>> chunks_;
+    OrderNodeIndex free_head_ = kNullOrderNode;
+    std::size_t live_count_ = 0;
+    std::size_t growth_count_ = 0;
+};
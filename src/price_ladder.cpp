@@ -0,0 +1,180 @@
+#include "price_ladder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace {
+
+PriceTicks floor_div(PriceTicks value, PriceTicks divisor) {
+    PriceTicks quotient = value / divisor;
+    if ((value % divisor != 0) && ((value < 0) != (divisor < 0))) {
+        --quotient;
+    }
+    return quotient;
+}
+
+}  // namespace
+
+template <Side S>
+PriceLevel& MapLadder<S>::level_at(PriceTicks price_ticks) {
+    auto [level_it, inserted] = levels_.try_emplace(price_ticks);
+    if (inserted) {
+        level_it->second.price_ticks = price_ticks;
+    }
+    return level_it->second;
+}
+
+template <Side S>
+void MapLadder<S>::release(PriceLevel& level) {
+    assert(level.empty() && "Releasing a non-empty price level");
+    auto best_it = levels_.begin();
+    if (&best_it->second == &level) {
+        levels_.erase(best_it);
+        return;
+    }
+    levels_.erase(level.price_ticks);
+}
+
+template <Side S>
+PriceLevel* MapLadder<S>::best() {
+    return levels_.empty() ? nullptr : &levels_.begin()->second;
+}
+
+template <Side S>
+const PriceLevel* MapLadder<S>::best() const {
+    return levels_.empty() ? nullptr : &levels_.begin()->second;
+}
+
+template <Side S>
+DenseLadder<S>::DenseLadder(PriceTicks tick_size, std::size_t initial_levels, std::size_t max_levels)
+    : tick_size_(tick_size),
+      initial_levels_(initial_levels > 0 ? initial_levels : 1),
+      max_levels_(max_levels > 0 ? max_levels : 1) {
+    assert(tick_size_ > 0 && "DenseLadder tick size must be positive");
+}
+
+template <Side S>
+bool DenseLadder<S>::fits_price(PriceTicks price_ticks) const {
+    if (occupied_ == 0) {
+        return true;
+    }
+    const PriceTicks best = levels_[best_index_].price_ticks;
+    const PriceTicks worst = levels_[worst_index_].price_ticks;
+    const PriceTicks low = std::min(price_ticks, std::min(best, worst));
+    const PriceTicks high = std::max(price_ticks, std::max(best, worst));
+    // Both ends are positive prices, so the difference cannot overflow.
+    return static_cast<std::size_t>((high - low) / tick_size_) < max_levels_;
+}
+
+template <Side S>
+bool DenseLadder<S>::covers(PriceTicks price_ticks) const {
+    if (levels_.empty() || price_ticks < base_price_ticks_) {
+        return false;
+    }
+    return index_of(price_ticks) < levels_.size();
+}
+
+template <Side S>
+PriceLevel& DenseLadder<S>::level_at(PriceTicks price_ticks, OrderPool& pool) {
+    assert(accepts_price(price_ticks) && "Price is not on the dense ladder tick grid");
+    assert(fits_price(price_ticks) && "Price is outside the dense ladder's maximum span");
+    if (!covers(price_ticks)) {
+        recentre(price_ticks, pool);
+    }
+
+    const std::size_t index = index_of(price_ticks);
+    PriceLevel& level = levels_[index];
+    if (level.empty()) {
+        if (occupied_ == 0 || better(index, best_index_)) {
+            best_index_ = index;
+        }
+        if (occupied_ == 0 || better(worst_index_, index)) {
+            worst_index_ = index;
+        }
+        ++occupied_;
+    }
+    return level;
+}
+
+template <Side S>
+void DenseLadder<S>::release(PriceLevel& level) {
+    assert(level.empty() && "Releasing a non-empty price level");
+    assert(occupied_ > 0 && "Releasing a level on an empty ladder");
+    --occupied_;
+
+    const auto index = static_cast<std::size_t>(&level - levels_.data());
+    if (occupied_ == 0) {
+        return;
+    }
+    if (index == best_index_) {
+        // The touch emptied: walk away from it to the next occupied level.
+        do {
+            best_index_ = step_away_from_touch(best_index_);
+        } while (levels_[best_index_].empty());
+    } else if (index == worst_index_) {
+        do {
+            worst_index_ = step_toward_touch(worst_index_);
+        } while (levels_[worst_index_].empty());
+    }
+}
+
+template <Side S>
+void DenseLadder<S>::recentre(PriceTicks price_ticks, OrderPool& pool) {
+    PriceTicks low = price_ticks;
+    PriceTicks high = price_ticks;
+    for (const auto& level : levels_) {
+        if (level.empty()) {
+            continue;
+        }
+        low = level.price_ticks < low ? level.price_ticks : low;
+        high = level.price_ticks > high ? level.price_ticks : high;
+    }
+
+    // Keep at least as much headroom as the occupied band so drift does not recentre
+    // on every new price.
+    const auto band_levels = static_cast<std::size_t>((high - low) / tick_size_) + 1;
+    std::size_t window = levels_.empty() ? initial_levels_ : levels_.size();
+    while (window < 2 * band_levels) {
+        window *= 2;
+    }
+    // fits_price() keeps band_levels within max_levels_, so this cap always leaves room.
+    window = std::max(band_levels, std::min(window, 2 * max_levels_));
+
+    const auto slack = static_cast<PriceTicks>((window - band_levels) / 2);
+    const PriceTicks new_base = (floor_div(low, tick_size_) - slack) * tick_size_;
+
+    std::vector<PriceLevel> moved(window);
+    for (std::size_t i = 0; i < window; ++i) {
+        moved[i].price_ticks = new_base + static_cast<PriceTicks>(i) * tick_size_;
+    }
+
+    for (const auto& level : levels_) {
+        if (level.empty()) {
+            continue;
+        }
+        PriceLevel& target =
+            moved[static_cast<std::size_t>((level.price_ticks - new_base) / tick_size_)];
+        target.head = level.head;
+        target.tail = level.tail;
+        target.total_quantity = level.total_quantity;
+        target.order_count = level.order_count;
+        for (OrderNodeIndex node = target.head; node != kNullOrderNode; node = pool.node(node).next) {
+            pool.node(node).level = &target;
+        }
+    }
+
+    if (occupied_ > 0) {
+        const PriceTicks best_price = levels_[best_index_].price_ticks;
+        const PriceTicks worst_price = levels_[worst_index_].price_ticks;
+        best_index_ = static_cast<std::size_t>((best_price - new_base) / tick_size_);
+        worst_index_ = static_cast<std::size_t>((worst_price - new_base) / tick_size_);
+    }
+    base_price_ticks_ = new_base;
+    levels_ = std::move(moved);
+}
+
+template class MapLadder<Side::BUY>;
+template class MapLadder<Side::SELL>;
+template class DenseLadder<Side::BUY>;
+template class DenseLadder<Side::SELL>;
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+#include "order_pool.h"
+#include "types.h"
+
+enum class LadderBackend { MAP, DENSE };
+
+// Both ladders hand out PriceLevel queue heads and never own the orders themselves.
+// `level_at` finds or creates the level an order is about to be appended to, and
+// `release` is called once a level has become empty.
+
+// Both ladders are specialised on the side they hold, so "better price" is resolved at
+// compile time: bids prefer higher prices, asks lower.
+
+// Sparse ladder: one tree node per occupied price.
+template <Side S>
+class MapLadder {
+public:
+    PriceLevel& level_at(PriceTicks price_ticks);
+    void release(PriceLevel& level);
+
+    PriceLevel* best();
+    const PriceLevel* best() const;
+    bool empty() const { return levels_.empty(); }
+    std::size_t level_count() const { return levels_.size(); }
+
+    template <typename Visitor>
+    void visit(std::size_t max_levels, Visitor&& visitor) const {
+        std::size_t visited = 0;
+        for (auto it = levels_.begin(); it != levels_.end() && visited < max_levels; ++it, ++visited) {
+            visitor(it->second);
+        }
+    }
+
+private:
+    using PriceComparator =
+        std::conditional_t<S == Side::BUY, std::greater<PriceTicks>, std::less<PriceTicks>>;
+
+    std::map<PriceTicks, PriceLevel, PriceComparator> levels_;
+};
+
+// Dense ladder: a contiguous array of levels indexed by (price_ticks - base) / tick_size,
+// ascending in price. The window is recentred (and grown when the occupied band no longer
+// fits) when a price lands outside it; resting nodes are re-pointed at their moved level.
+// The occupied band may span at most `max_levels` levels, which bounds the window at about
+// twice that; callers check fits_price() before adding a level.
+template <Side S>
+class DenseLadder {
+public:
+    DenseLadder(PriceTicks tick_size, std::size_t initial_levels, std::size_t max_levels);
+
+    bool accepts_price(PriceTicks price_ticks) const { return price_ticks % tick_size_ == 0; }
+    // True when a level at `price_ticks` keeps the occupied band within max_levels.
+    bool fits_price(PriceTicks price_ticks) const;
+    PriceTicks tick_size() const { return tick_size_; }
+
+    PriceLevel& level_at(PriceTicks price_ticks, OrderPool& pool);
+    void release(PriceLevel& level);
+
+    PriceLevel* best() { return occupied_ == 0 ? nullptr : &levels_[best_index_]; }
+    const PriceLevel* best() const { return occupied_ == 0 ? nullptr : &levels_[best_index_]; }
+    bool empty() const { return occupied_ == 0; }
+    std::size_t level_count() const { return occupied_; }
+    std::size_t window_levels() const { return levels_.size(); }
+
+    template <typename Visitor>
+    void visit(std::size_t max_levels, Visitor&& visitor) const {
+        std::size_t remaining = occupied_ < max_levels ? occupied_ : max_levels;
+        std::size_t index = best_index_;
+        while (remaining > 0) {
+            if (!levels_[index].empty()) {
+                visitor(levels_[index]);
+                --remaining;
+            }
+            index = step_away_from_touch(index);
+        }
+    }
+
+private:
+    std::size_t index_of(PriceTicks price_ticks) const {
+        return static_cast<std::size_t>((price_ticks - base_price_ticks_) / tick_size_);
+    }
+    bool covers(PriceTicks price_ticks) const;
+    static bool better(std::size_t lhs, std::size_t rhs) {
+        if constexpr (S == Side::BUY) {
+            return lhs > rhs;
+        } else {
+            return lhs < rhs;
+        }
+    }
+    static std::size_t step_away_from_touch(std::size_t index) {
+        if constexpr (S == Side::BUY) {
+            return index - 1;
+        } else {
+            return index + 1;
+        }
+    }
+    static std::size_t step_toward_touch(std::size_t index) {
+        if constexpr (S == Side::BUY) {
+            return index + 1;
+        } else {
+            return index - 1;
+        }
+    }
+    void recentre(PriceTicks price_ticks, OrderPool& pool);
+
+    PriceTicks tick_size_;
+    std::size_t initial_levels_;
+    std::size_t max_levels_;
+    std::vector<PriceLevel> levels_;
+    PriceTicks base_price_ticks_ = 0;
+    std::size_t best_index_ = 0;
+    // Occupied level furthest from the touch; with best_index_ it bounds the occupied band.
+    std::size_t worst_index_ = 0;
+    std::size_t occupied_ = 0;
+};
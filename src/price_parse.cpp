@@ -0,0 +1,114 @@
+#include "price_parse.h"
+
+#include <cstddef>
+#include <limits>
+
+namespace {
+
+constexpr int decimal_digits_of(PriceTicks ticks_per_unit) {
+    int digits = 0;
+    while (ticks_per_unit > 1) {
+        ticks_per_unit /= 10;
+        ++digits;
+    }
+    return digits;
+}
+
+constexpr bool is_power_of_ten(PriceTicks value) {
+    while (value > 1 && value % 10 == 0) {
+        value /= 10;
+    }
+    return value == 1;
+}
+
+static_assert(is_power_of_ten(kTicksPerUnit), "Decimal price parsing needs a power-of-ten kTicksPerUnit");
+
+constexpr int kFractionDigits = decimal_digits_of(kTicksPerUnit);
+
+bool is_digit(char ch) {
+    return ch >= '0' && ch <= '9';
+}
+
+// Inputs this short cannot overflow PriceTicks even after scaling to ticks, so the
+// common case skips the per-digit range checks.
+constexpr std::size_t kShortInputLength = 18 - kFractionDigits;
+
+// Appends one digit to a value accumulated as a negative number (so the most negative
+// PriceTicks is reachable), failing on overflow when `kChecked`.
+template <bool kChecked>
+bool push_digit(PriceTicks& ticks, int digit) {
+    if constexpr (kChecked) {
+        if (ticks < (std::numeric_limits<PriceTicks>::min() + digit) / 10) {
+            return false;
+        }
+    }
+    ticks = ticks * 10 - digit;
+    return true;
+}
+
+template <bool kChecked>
+bool parse_price(std::string_view text, PriceTicks& out_ticks) {
+    std::size_t pos = 0;
+    bool negative = false;
+    if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+        negative = text[pos] == '-';
+        ++pos;
+    }
+
+    PriceTicks ticks = 0;
+    bool any_digit = false;
+    for (; pos < text.size() && is_digit(text[pos]); ++pos) {
+        if (!push_digit<kChecked>(ticks, text[pos] - '0')) {
+            return false;
+        }
+        any_digit = true;
+    }
+
+    int fraction_digits = 0;
+    if (pos < text.size() && text[pos] == '.') {
+        ++pos;
+        for (; pos < text.size() && is_digit(text[pos]); ++pos) {
+            const int digit = text[pos] - '0';
+            any_digit = true;
+            if (fraction_digits == kFractionDigits) {
+                // Finer than one tick: only trailing zeros are exact.
+                if (digit != 0) {
+                    return false;
+                }
+                continue;
+            }
+            if (!push_digit<kChecked>(ticks, digit)) {
+                return false;
+            }
+            ++fraction_digits;
+        }
+    }
+
+    if (!any_digit || pos != text.size()) {
+        return false;
+    }
+
+    for (; fraction_digits < kFractionDigits; ++fraction_digits) {
+        if (!push_digit<kChecked>(ticks, 0)) {
+            return false;
+        }
+    }
+
+    if (!negative) {
+        if (ticks == std::numeric_limits<PriceTicks>::min()) {
+            return false;
+        }
+        ticks = -ticks;
+    }
+    out_ticks = ticks;
+    return true;
+}
+
+}  // namespace
+
+bool parse_decimal_price_ticks(std::string_view text, PriceTicks& out_ticks) {
+    if (text.size() <= kShortInputLength) {
+        return parse_price<false>(text, out_ticks);
+    }
+    return parse_price<true>(text, out_ticks);
+}
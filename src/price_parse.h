@@ -0,0 +1,10 @@
+#pragma once
+
+#include <string_view>
+
+#include "types.h"
+
+// Parses a plain decimal price ("100.25", "+7", ".5", "12.") straight to PriceTicks in
+// integer arithmetic. Fraction digits beyond the tick precision of kTicksPerUnit must be
+// zeros; exponents, embedded spaces and values that overflow PriceTicks are rejected.
+bool parse_decimal_price_ticks(std::string_view text, PriceTicks& out_ticks);
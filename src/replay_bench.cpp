@@ -0,0 +1,184 @@
+#include "replay_bench.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include "csv_replay.h"
+#include "replay_binary.h"
+#include "replay_rows.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Reads `path` into rows in file order, without sorting.
+bool read_replay_rows(const std::string& path, std::vector<ReplayRow>& out_rows, std::string& out_error) {
+    if (!is_replay_binary_file(path)) {
+        return parse_replay_csv_rows(path, out_rows, out_error);
+    }
+    ReplayBinaryFile file;
+    if (!file.open(path, out_error)) {
+        return false;
+    }
+    out_rows.clear();
+    out_rows.reserve(file.size());
+    for (std::size_t i = 0; i < file.size(); ++i) {
+        out_rows.push_back(file[i]);
+    }
+    return true;
+}
+
+// Nearest-rank percentile of sorted, non-empty `values`.
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted_values, double p) {
+    const auto rank = static_cast<std::size_t>(p * static_cast<double>(sorted_values.size() - 1) + 0.5);
+    return sorted_values[std::min(rank, sorted_values.size() - 1)];
+}
+
+void measure_latency(const std::vector<ReplayRow>& rows,
+                     const EngineConfig& config,
+                     ReplayBenchResult& out_result) {
+    if (rows.empty()) {
+        return;
+    }
+    MatchingEngine engine(config);
+    std::vector<std::uint64_t> latencies;
+    latencies.reserve(rows.size());
+    std::vector<Trade> trades;
+    ActionResult result;
+    for (const ReplayRow& row : rows) {
+        const EngineAction action = to_engine_action(row);
+        trades.clear();
+        const auto start = Clock::now();
+        engine.process_batch(&action, 1, &result, trades);
+        const auto stop = Clock::now();
+        latencies.push_back(
+            static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count()));
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    out_result.latency_p50_ns = percentile(latencies, 0.50);
+    out_result.latency_p99_ns = percentile(latencies, 0.99);
+    out_result.latency_p999_ns = percentile(latencies, 0.999);
+    out_result.latency_max_ns = latencies.back();
+}
+
+std::size_t peak_rss_bytes() {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    // Linux reports ru_maxrss in kilobytes.
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+}
+
+std::string json_string(const std::string& text) {
+    std::ostringstream oss;
+    oss << '"';
+    for (const char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            oss << '\\' << ch;
+        } else if (static_cast<unsigned char>(ch) < 0x20) {
+            oss << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                << static_cast<int>(static_cast<unsigned char>(ch)) << std::dec << std::setfill(' ');
+        } else {
+            oss << ch;
+        }
+    }
+    oss << '"';
+    return oss.str();
+}
+
+}  // namespace
+
+bool run_replay_bench(const std::string& path,
+                      const ReplayBenchOptions& options,
+                      ReplayBenchResult& out_result,
+                      std::string& out_error) {
+    out_result = ReplayBenchResult{};
+    out_result.event_log_mode = options.engine.event_log_mode;
+
+    std::error_code ec;
+    const auto input_bytes = std::filesystem::file_size(path, ec);
+    out_result.input_bytes = ec ? 0 : static_cast<std::size_t>(input_bytes);
+
+    std::vector<ReplayRow> rows;
+    auto start = Clock::now();
+    if (!read_replay_rows(path, rows, out_error)) {
+        return false;
+    }
+    out_result.parse_seconds = seconds_since(start);
+    out_result.rows = rows.size();
+
+    start = Clock::now();
+    sort_replay_rows(rows);
+    out_result.sort_seconds = seconds_since(start);
+
+    {
+        MatchingEngine engine(options.engine);
+        std::size_t trades = 0;
+        start = Clock::now();
+        apply_replay_rows(engine, rows, [&trades](const ReplayRow&, const ActionResult& result, const Trade*) {
+            trades += result.trade_count;
+        });
+        out_result.match_seconds = seconds_since(start);
+        out_result.trades = trades;
+    }
+    if (out_result.match_seconds > 0.0) {
+        out_result.rows_per_second = static_cast<double>(out_result.rows) / out_result.match_seconds;
+        out_result.trades_per_second = static_cast<double>(out_result.trades) / out_result.match_seconds;
+    }
+
+    if (options.measure_latency) {
+        measure_latency(rows, options.engine, out_result);
+    }
+    out_result.peak_rss_bytes = peak_rss_bytes();
+    return true;
+}
+
+bool write_replay_bench_json(const std::string& json_path,
+                             const std::string& input_path,
+                             const ReplayBenchResult& result,
+                             std::string& out_error) {
+    std::ofstream output(json_path, std::ios::binary);
+    if (!output) {
+        out_error = "failed to open JSON output for writing: " + json_path;
+        return false;
+    }
+
+    output << std::fixed << std::setprecision(6);
+    output << "{\n"
+           << "  \"input\": " << json_string(input_path) << ",\n"
+           << "  \"input_bytes\": " << result.input_bytes << ",\n"
+           << "  \"rows\": " << result.rows << ",\n"
+           << "  \"trades\": " << result.trades << ",\n"
+           << "  \"event_log\": " << json_string(event_log_mode_name(result.event_log_mode)) << ",\n"
+           << "  \"parse_seconds\": " << result.parse_seconds << ",\n"
+           << "  \"sort_seconds\": " << result.sort_seconds << ",\n"
+           << "  \"match_seconds\": " << result.match_seconds << ",\n"
+           << "  \"rows_per_second\": " << std::setprecision(1) << result.rows_per_second << ",\n"
+           << "  \"trades_per_second\": " << result.trades_per_second << ",\n"
+           << "  \"latency_p50_ns\": " << result.latency_p50_ns << ",\n"
+           << "  \"latency_p99_ns\": " << result.latency_p99_ns << ",\n"
+           << "  \"latency_p999_ns\": " << result.latency_p999_ns << ",\n"
+           << "  \"latency_max_ns\": " << result.latency_max_ns << ",\n"
+           << "  \"peak_rss_bytes\": " << result.peak_rss_bytes << "\n"
+           << "}\n";
+
+    output.close();
+    if (!output) {
+        out_error = "failed while writing JSON output: " + json_path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "matching_engine.h"
+
+struct ReplayBenchOptions {
+    ReplayBenchOptions() { engine.event_log_mode = EventLogMode::OFF; }
+
+    // Event capture is off by default, as in the backtests, so the match phase times
+    // matching alone; set engine.event_log_mode to include RING or FULL capture.
+    EngineConfig engine;
+    // Run a second replay that times every action on its own; it is left out of
+    // match_seconds because reading the clock per action slows the loop down.
+    bool measure_latency = true;
+};
+
+struct ReplayBenchResult {
+    std::size_t input_bytes = 0;
+    std::size_t rows = 0;
+    std::size_t trades = 0;
+    EventLogMode event_log_mode = EventLogMode::OFF;
+    // Parse covers reading the file into rows (CSV parse or .merb copy), sort covers
+    // sort_replay_rows, and match covers feeding the rows to the engine in batches.
+    double parse_seconds = 0.0;
+    double sort_seconds = 0.0;
+    double match_seconds = 0.0;
+    double rows_per_second = 0.0;
+    double trades_per_second = 0.0;
+    // Per-action engine latency in nanoseconds; all 0 when latency was not measured.
+    std::uint64_t latency_p50_ns = 0;
+    std::uint64_t latency_p99_ns = 0;
+    std::uint64_t latency_p999_ns = 0;
+    std::uint64_t latency_max_ns = 0;
+    // Peak resident set of the whole process so far.
+    std::size_t peak_rss_bytes = 0;
+};
+
+// Replays `path` (replay CSV or .merb) once per phase and times each phase separately.
+bool run_replay_bench(const std::string& path,
+                      const ReplayBenchOptions& options,
+                      ReplayBenchResult& out_result,
+                      std::string& out_error);
+
+// Writes `result` as one JSON object, for tracking runs over time.
+bool write_replay_bench_json(const std::string& json_path,
+                             const std::string& input_path,
+                             const ReplayBenchResult& result,
+                             std::string& out_error);
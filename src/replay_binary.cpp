@@ -0,0 +1,245 @@
+#include "replay_binary.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool replay_order_less(std::uint64_t lhs_ts,
+                       std::uint64_t lhs_seq,
+                       std::uint64_t lhs_index,
+                       std::uint64_t rhs_ts,
+                       std::uint64_t rhs_seq,
+                       std::uint64_t rhs_index) {
+    if (lhs_ts != rhs_ts) {
+        return lhs_ts < rhs_ts;
+    }
+    if (lhs_seq != rhs_seq) {
+        return lhs_seq < rhs_seq;
+    }
+    return lhs_index < rhs_index;
+}
+
+bool rows_in_replay_order(const std::vector<ReplayRow>& rows) {
+    for (std::size_t i = 1; i < rows.size(); ++i) {
+        if (replay_row_before(rows[i], rows[i - 1])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The checks parse_replay_csv_rows applies to the same row, so a .merb file accepts exactly
+// what its CSV would. Returns nullptr when `record` passes them.
+const char* record_field_error(const ReplayBinaryRecord& record) {
+    if (record.action > static_cast<std::uint8_t>(ReplayAction::REPLACE) ||
+        record.side > static_cast<std::uint8_t>(Side::SELL) ||
+        record.type > static_cast<std::uint8_t>(OrderType::MARKET) ||
+        record.tif > static_cast<std::uint8_t>(TimeInForce::IOC) || record.row_index >= kMaxReplayRows) {
+        return "invalid enum field or row_index";
+    }
+    if (record.order_id <= 0) {
+        return "invalid order_id (expected positive integer)";
+    }
+
+    const auto action = static_cast<ReplayAction>(record.action);
+    if (action == ReplayAction::NEW) {
+        if (record.type == static_cast<std::uint8_t>(OrderType::LIMIT) && record.price_ticks <= 0) {
+            return "invalid price for LIMIT order";
+        }
+        if (record.quantity <= 0) {
+            return "invalid qty (expected positive integer)";
+        }
+    } else if (action == ReplayAction::REPLACE) {
+        if (record.new_price_ticks <= 0) {
+            return "invalid new_price for REPLACE";
+        }
+        if (record.new_quantity <= 0) {
+            return "invalid new_qty for REPLACE";
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
+
+ReplayBinaryRecord to_replay_binary_record(const ReplayRow& row) {
+    ReplayBinaryRecord record{};
+    record.ts_ns = row.ts_ns;
+    record.seq = row.seq;
+    record.row_index = row.row_index;
+    record.order_id = row.order_id;
+    if (row.action == ReplayAction::REPLACE) {
+        record.new_price_ticks = row.price_ticks;
+        record.new_quantity = row.quantity;
+    } else {
+        record.price_ticks = row.price_ticks;
+        record.quantity = row.quantity;
+    }
+    record.action = static_cast<std::uint8_t>(row.action);
+    record.side = static_cast<std::uint8_t>(row.side);
+    record.type = static_cast<std::uint8_t>(row.type);
+    record.tif = static_cast<std::uint8_t>(row.tif);
+    return record;
+}
+
+ReplayRow from_replay_binary_record(const ReplayBinaryRecord& record) {
+    ReplayRow row;
+    row.ts_ns = record.ts_ns;
+    row.seq = record.seq;
+    row.row_index = static_cast<std::uint32_t>(record.row_index);
+    row.action = static_cast<ReplayAction>(record.action);
+    row.order_id = record.order_id;
+    row.side = static_cast<Side>(record.side);
+    row.type = static_cast<OrderType>(record.type);
+    row.tif = static_cast<TimeInForce>(record.tif);
+    const bool replace = row.action == ReplayAction::REPLACE;
+    row.price_ticks = replace ? record.new_price_ticks : record.price_ticks;
+    row.quantity = replace ? record.new_quantity : record.quantity;
+    return row;
+}
+
+bool write_replay_binary(const std::string& path,
+                         const std::vector<ReplayRow>& rows,
+                         std::string& out_error) {
+    std::FILE* output = std::fopen(path.c_str(), "wb");
+    if (output == nullptr) {
+        out_error = "failed to open replay binary for writing: " + path;
+        return false;
+    }
+
+    ReplayBinaryHeader header{};
+    std::memcpy(header.magic, kReplayBinaryMagic, sizeof(header.magic));
+    header.version = kReplayBinaryVersion;
+    header.record_size = sizeof(ReplayBinaryRecord);
+    header.byte_order = kReplayBinaryByteOrder;
+    header.flags = rows_in_replay_order(rows) ? kReplayBinarySorted : 0;
+    header.row_count = rows.size();
+    bool ok = std::fwrite(&header, sizeof(header), 1, output) == 1;
+
+    // Records go out in blocks so the row conversion stays in cache.
+    constexpr std::size_t kBlockRows = 4096;
+    std::vector<ReplayBinaryRecord> block;
+    block.reserve(kBlockRows);
+    for (std::size_t begin = 0; ok && begin < rows.size(); begin += kBlockRows) {
+        const std::size_t end = std::min(rows.size(), begin + kBlockRows);
+        block.clear();
+        for (std::size_t i = begin; i < end; ++i) {
+            block.push_back(to_replay_binary_record(rows[i]));
+        }
+        ok = std::fwrite(block.data(), sizeof(ReplayBinaryRecord), block.size(), output) == block.size();
+    }
+
+    ok = std::fclose(output) == 0 && ok;
+    if (!ok) {
+        out_error = "failed while writing replay binary: " + path;
+        return false;
+    }
+    return true;
+}
+
+bool is_replay_binary_file(const std::string& path) {
+    // Peeking at a pipe would consume its first bytes, so only regular files are checked.
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(path, ec)) {
+        return false;
+    }
+    std::FILE* input = std::fopen(path.c_str(), "rb");
+    if (input == nullptr) {
+        return false;
+    }
+    char magic[sizeof(kReplayBinaryMagic)] = {};
+    const bool read = std::fread(magic, sizeof(magic), 1, input) == 1;
+    std::fclose(input);
+    return read && std::memcmp(magic, kReplayBinaryMagic, sizeof(magic)) == 0;
+}
+
+bool ReplayBinaryFile::open(const std::string& path, std::string& out_error) {
+    records_ = nullptr;
+    row_count_ = 0;
+    sorted_ = false;
+
+    if (!file_.open(path, out_error)) {
+        return false;
+    }
+
+    ReplayBinaryHeader header{};
+    if (file_.size() < sizeof(header)) {
+        out_error = "replay binary is truncated: " + path;
+        return false;
+    }
+    std::memcpy(&header, file_.data(), sizeof(header));
+    if (std::memcmp(header.magic, kReplayBinaryMagic, sizeof(header.magic)) != 0) {
+        out_error = "not a replay binary file: " + path;
+        return false;
+    }
+    if (header.byte_order != kReplayBinaryByteOrder) {
+        out_error = "replay binary was written with a different byte order: " + path;
+        return false;
+    }
+    if (header.version != kReplayBinaryVersion || header.record_size != sizeof(ReplayBinaryRecord)) {
+        out_error = "unsupported replay binary version " + std::to_string(header.version) + ": " + path;
+        return false;
+    }
+    if ((file_.size() - sizeof(header)) / sizeof(ReplayBinaryRecord) != header.row_count ||
+        (file_.size() - sizeof(header)) % sizeof(ReplayBinaryRecord) != 0) {
+        out_error = "replay binary length does not match its row count: " + path;
+        return false;
+    }
+
+    // The mapping is page aligned, so records after the 32-byte header are naturally aligned.
+    const auto* records = reinterpret_cast<const ReplayBinaryRecord*>(file_.data() + sizeof(header));
+    const auto row_count = static_cast<std::size_t>(header.row_count);
+    bool in_order = true;
+    for (std::size_t i = 0; i < row_count; ++i) {
+        const ReplayBinaryRecord& record = records[i];
+        if (const char* field_error = record_field_error(record)) {
+            out_error = "record " + std::to_string(i) + ": " + field_error + " in " + path;
+            return false;
+        }
+        if (i > 0) {
+            const ReplayBinaryRecord& prev = records[i - 1];
+            in_order = in_order && !replay_order_less(record.ts_ns, record.seq, record.row_index,
+                                                      prev.ts_ns, prev.seq, prev.row_index);
+        }
+    }
+    if ((header.flags & kReplayBinarySorted) != 0 && !in_order) {
+        out_error = "replay binary is flagged sorted but its records are out of order: " + path;
+        return false;
+    }
+
+    records_ = records;
+    row_count_ = row_count;
+    sorted_ = in_order;
+    return true;
+}
+
+bool load_replay_rows(const std::string& path,
+                      std::vector<ReplayRow>& out_rows,
+                      std::string& out_error) {
+    if (!is_replay_binary_file(path)) {
+        if (!parse_replay_csv_rows(path, out_rows, out_error)) {
+            return false;
+        }
+        sort_replay_rows(out_rows);
+        return true;
+    }
+
+    ReplayBinaryFile file;
+    if (!file.open(path, out_error)) {
+        return false;
+    }
+    out_rows.clear();
+    out_rows.reserve(file.size());
+    for (std::size_t i = 0; i < file.size(); ++i) {
+        out_rows.push_back(file[i]);
+    }
+    if (!file.sorted()) {
+        sort_replay_rows(out_rows);
+    }
+    return true;
+}
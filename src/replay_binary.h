@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "replay_rows.h"
+
+// Binary replay format (.merb): a fixed header followed by fixed-width records, one per
+// ReplayRow, in host byte order. Records keep NEW and REPLACE payloads in separate fields.
+// Loading skips CSV parsing, and also sort_replay_rows when the header has the sorted flag;
+// write_replay_binary writes rows in the order given and sets that flag only when they are
+// already in replay order.
+constexpr char kReplayBinaryMagic[4] = {'M', 'E', 'R', 'B'};
+constexpr std::uint16_t kReplayBinaryVersion = 1;
+
+struct ReplayBinaryHeader {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t record_size;
+    // Reads back as kReplayBinaryByteOrder only on a host with the writer's byte order.
+    std::uint32_t byte_order;
+    std::uint32_t flags;
+    std::uint64_t row_count;
+    std::uint64_t reserved;
+};
+
+constexpr std::uint32_t kReplayBinaryByteOrder = 0x01020304;
+// Records are in (ts_ns, seq, row_index) order.
+constexpr std::uint32_t kReplayBinarySorted = 1u << 0;
+
+struct ReplayBinaryRecord {
+    std::uint64_t ts_ns;
+    std::uint64_t seq;
+    std::uint64_t row_index;
+    std::int64_t price_ticks;
+    std::int64_t new_price_ticks;
+    std::int32_t order_id;
+    std::int32_t quantity;
+    std::int32_t new_quantity;
+    std::uint8_t action;
+    std::uint8_t side;
+    std::uint8_t type;
+    std::uint8_t tif;
+};
+
+static_assert(sizeof(ReplayBinaryHeader) == 32, "ReplayBinaryHeader layout is part of the file format");
+static_assert(sizeof(ReplayBinaryRecord) == 56, "ReplayBinaryRecord layout is part of the file format");
+
+ReplayBinaryRecord to_replay_binary_record(const ReplayRow& row);
+ReplayRow from_replay_binary_record(const ReplayBinaryRecord& record);
+
+// Writes `rows` as a .merb file; the sorted flag is set when they are in replay order.
+bool write_replay_binary(const std::string& path,
+                         const std::vector<ReplayRow>& rows,
+                         std::string& out_error);
+
+// True if `path` is a regular file that starts with kReplayBinaryMagic. Pipes and other
+// non-regular inputs are read as CSV.
+bool is_replay_binary_file(const std::string& path);
+
+// Read-only view of a mapped .merb file. open() checks the header, the file length, every
+// record's enum fields and row_index, and the order id, price and quantity checks the CSV
+// parser applies, so rows can then be read without further checks.
+class ReplayBinaryFile {
+public:
+    bool open(const std::string& path, std::string& out_error);
+
+    std::size_t size() const { return row_count_; }
+    bool empty() const { return row_count_ == 0; }
+    bool sorted() const { return sorted_; }
+
+    const ReplayBinaryRecord& record(std::size_t index) const { return records_[index]; }
+    ReplayRow operator[](std::size_t index) const { return from_replay_binary_record(records_[index]); }
+
+private:
+    MappedFile file_;
+    const ReplayBinaryRecord* records_ = nullptr;
+    std::size_t row_count_ = 0;
+    bool sorted_ = false;
+};
+
+// Loads replay rows from either a .merb file or a replay CSV (detected by the magic) and
+// leaves them in replay order.
+bool load_replay_rows(const std::string& path,
+                      std::vector<ReplayRow>& out_rows,
+                      std::string& out_error);
@@ -3,11 +3,19 @@
 #include <algorithm>
 #include <array>
 #include <cctype>
-#include <fstream>
+#include <charconv>
+#include <limits>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "csv_scan.h"
+#include "mapped_file.h"
+#include "price_parse.h"
+
 namespace {
 
 constexpr std::size_t kColumnCount = 12;
@@ -26,7 +34,11 @@ constexpr std::array<const char*, kColumnCount> kExpectedHeader = {
     "notes"
 };
 
-std::string trim_copy(const std::string& value) {
+using Fields = std::array<std::string_view, kColumnCount>;
+// Comma offsets for one line; a line with more commas only needs the count.
+using CommaOffsets = std::array<std::uint32_t, kColumnCount>;
+
+std::string_view trim_view(std::string_view value) {
     std::size_t first = 0;
     while (first < value.size() && std::isspace(static_cast<unsigned char>(value[first]))) {
         ++first;
@@ -40,18 +52,48 @@ std::string trim_copy(const std::string& value) {
     return value.substr(first, last - first);
 }
 
-bool split_csv_line(const std::string& line,
-                    std::vector<std::string>& out_fields,
+// Splits one line into trimmed fields. The first kColumnCount fields are stored in
+// `out_fields` and `out_count` receives the total, so a wrong column count can still be
+// reported. `scan` is the structural scan of `line`: unquoted lines are cut at its comma
+// offsets in place; a line containing quotes is unescaped into `scratch` (reused across
+// lines) and the fields point into it.
+bool split_csv_line(std::string_view line,
+                    const CsvLineScan& scan,
+                    const CommaOffsets& commas,
+                    Fields& out_fields,
+                    std::size_t& out_count,
+                    std::string& scratch,
                     std::string& out_error) {
-    out_fields.clear();
-    std::string field;
+    out_count = scan.comma_count + 1;
+    if (!scan.has_quote) {
+        const std::size_t stored = std::min(out_count, kColumnCount);
+        std::size_t field_start = 0;
+        for (std::size_t i = 0; i < stored; ++i) {
+            const std::size_t field_end = i < scan.comma_count ? commas[i] : line.size();
+            out_fields[i] = trim_view(line.substr(field_start, field_end - field_start));
+            field_start = field_end + 1;
+        }
+        return true;
+    }
+
+    out_count = 0;
+    scratch.clear();
+    std::array<std::pair<std::size_t, std::size_t>, kColumnCount> bounds{};
+    std::size_t field_start = 0;
     bool in_quotes = false;
+    auto end_field = [&]() {
+        if (out_count < kColumnCount) {
+            bounds[out_count] = {field_start, scratch.size()};
+        }
+        ++out_count;
+        field_start = scratch.size();
+    };
 
     for (std::size_t i = 0; i < line.size(); ++i) {
         const char ch = line[i];
         if (ch == '"') {
             if (in_quotes && i + 1 < line.size() && line[i + 1] == '"') {
-                field.push_back('"');
+                scratch.push_back('"');
                 ++i;
             } else {
                 in_quotes = !in_quotes;
@@ -60,12 +102,11 @@ bool split_csv_line(const std::string& line,
         }
 
         if (ch == ',' && !in_quotes) {
-            out_fields.push_back(trim_copy(field));
-            field.clear();
+            end_field();
             continue;
         }
 
-        field.push_back(ch);
+        scratch.push_back(ch);
     }
 
     if (in_quotes) {
@@ -73,54 +114,44 @@ bool split_csv_line(const std::string& line,
         return false;
     }
 
-    out_fields.push_back(trim_copy(field));
+    end_field();
+    const std::string_view unescaped(scratch);
+    for (std::size_t i = 0; i < std::min(out_count, kColumnCount); ++i) {
+        out_fields[i] = trim_view(unescaped.substr(bounds[i].first, bounds[i].second - bounds[i].first));
+    }
     return true;
 }
 
+// Whole-field integer parse. Like the stream extraction it replaced, a leading '+' is accepted.
 template <typename NumberType>
-bool parse_number(const std::string& value, NumberType& out_number) {
-    std::istringstream iss(value);
-    iss >> out_number;
-    if (iss.fail()) {
-        return false;
+bool parse_number(std::string_view value, NumberType& out_number) {
+    if (!value.empty() && value.front() == '+') {
+        value.remove_prefix(1);
     }
-
-    char trailing = '\0';
-    if (iss >> trailing) {
-        return false;
-    }
-    return true;
+    const char* last = value.data() + value.size();
+    const auto [end, error] = std::from_chars(value.data(), last, out_number);
+    return error == std::errc() && end == last;
 }
 
-bool parse_u64(const std::string& value, std::uint64_t& out_value) {
+bool parse_u64(std::string_view value, std::uint64_t& out_value) {
     if (value.empty() || value.front() == '-') {
         return false;
     }
     return parse_number(value, out_value);
 }
 
-bool parse_int(const std::string& value, int& out_value) {
+bool parse_int(std::string_view value, int& out_value) {
     if (value.empty()) {
         return false;
     }
     return parse_number(value, out_value);
 }
 
-bool parse_price_ticks(const std::string& value, PriceTicks& out_ticks) {
-    if (value.empty()) {
-        return false;
-    }
-
-    double price = 0.0;
-    if (!parse_number(value, price)) {
-        return false;
-    }
-
-    out_ticks = price_to_ticks(price);
-    return true;
+bool parse_price_ticks(std::string_view value, PriceTicks& out_ticks) {
+    return parse_decimal_price_ticks(value, out_ticks);
 }
 
-bool parse_action(const std::string& value, ReplayAction& out_action) {
+bool parse_action(std::string_view value, ReplayAction& out_action) {
     if (value == "NEW") {
         out_action = ReplayAction::NEW;
         return true;
@@ -136,7 +167,7 @@ bool parse_action(const std::string& value, ReplayAction& out_action) {
     return false;
 }
 
-bool parse_side(const std::string& value, Side& out_side) {
+bool parse_side(std::string_view value, Side& out_side) {
     if (value == "BUY") {
         out_side = Side::BUY;
         return true;
@@ -148,7 +179,7 @@ bool parse_side(const std::string& value, Side& out_side) {
     return false;
 }
 
-bool parse_order_type(const std::string& value, OrderType& out_type) {
+bool parse_order_type(std::string_view value, OrderType& out_type) {
     if (value == "LIMIT") {
         out_type = OrderType::LIMIT;
         return true;
@@ -160,7 +191,7 @@ bool parse_order_type(const std::string& value, OrderType& out_type) {
     return false;
 }
 
-bool parse_tif(const std::string& value, TimeInForce& out_tif) {
+bool parse_tif(std::string_view value, TimeInForce& out_tif) {
     if (value.empty() || value == "GTC") {
         out_tif = TimeInForce::GTC;
         return true;
@@ -178,8 +209,8 @@ std::string line_error(std::size_t line_no, const std::string& message) {
     return oss.str();
 }
 
-bool check_header(const std::vector<std::string>& fields, std::string& out_error) {
-    if (fields.size() != kColumnCount) {
+bool check_header(const Fields& fields, std::size_t field_count, std::string& out_error) {
+    if (field_count != kColumnCount) {
         std::ostringstream oss;
         oss << "invalid header: expected " << kColumnCount << " columns";
         out_error = oss.str();
@@ -198,14 +229,15 @@ bool check_header(const std::vector<std::string>& fields, std::string& out_error
     return true;
 }
 
-bool parse_row(const std::vector<std::string>& fields,
+bool parse_row(const Fields& fields,
+               std::size_t field_count,
                std::size_t line_no,
                std::size_t row_index,
                ReplayRow& out_row,
                std::string& out_error) {
-    if (fields.size() != kColumnCount) {
+    if (field_count != kColumnCount) {
         std::ostringstream oss;
-        oss << "expected " << kColumnCount << " columns, found " << fields.size();
+        oss << "expected " << kColumnCount << " columns, found " << field_count;
         out_error = line_error(line_no, oss.str());
         return false;
     }
@@ -223,7 +255,7 @@ bool parse_row(const std::vector<std::string>& fields,
         return false;
     }
 
-    out_row.row_index = row_index;
+    out_row.row_index = static_cast<std::uint32_t>(row_index);
     if (!parse_int(fields[3], out_row.order_id) || out_row.order_id <= 0) {
         out_error = line_error(line_no, "invalid order_id (expected positive integer)");
         return false;
@@ -264,11 +296,11 @@ bool parse_row(const std::vector<std::string>& fields,
         return true;
     }
 
-    if (!parse_price_ticks(fields[9], out_row.new_price_ticks) || out_row.new_price_ticks <= 0) {
+    if (!parse_price_ticks(fields[9], out_row.price_ticks) || out_row.price_ticks <= 0) {
         out_error = line_error(line_no, "invalid new_price for REPLACE");
         return false;
     }
-    if (!parse_int(fields[10], out_row.new_quantity) || out_row.new_quantity <= 0) {
+    if (!parse_int(fields[10], out_row.quantity) || out_row.quantity <= 0) {
         out_error = line_error(line_no, "invalid new_qty for REPLACE");
         return false;
     }
@@ -276,71 +308,479 @@ bool parse_row(const std::vector<std::string>& fields,
     return true;
 }
 
-}  // namespace
+// Hands out lines the way std::getline does: split on '\n', no empty line after a
+// trailing newline. The same pass records each line's commas and quotes.
+class LineReader {
+public:
+    explicit LineReader(std::string_view text) : text_(text) {}
 
-bool parse_replay_csv_rows(const std::string& csv_path,
-                           std::vector<ReplayRow>& out_rows,
-                           std::string& out_error) {
-    out_rows.clear();
+    bool next(std::string_view& out_line) {
+        if (cursor_ >= text_.size()) {
+            return false;
+        }
+        scan_ = scan_csv_line(text_.data() + cursor_, text_.data() + text_.size(), commas_.data(), commas_.size());
+        out_line = text_.substr(cursor_, scan_.length);
+        cursor_ += scan_.length + 1;
+        return true;
+    }
+
+    // Splits the line last returned by next().
+    bool split(std::string_view line,
+               Fields& out_fields,
+               std::size_t& out_count,
+               std::string& out_error) {
+        return split_csv_line(line, scan_, commas_, out_fields, out_count, scratch_, out_error);
+    }
 
-    std::ifstream input(csv_path);
-    if (!input.is_open()) {
+    // Offset of the first byte not yet handed out.
+    std::size_t consumed() const { return std::min(cursor_, text_.size()); }
+
+private:
+    std::string_view text_;
+    std::size_t cursor_ = 0;
+    CsvLineScan scan_;
+    CommaOffsets commas_{};
+    std::string scratch_;
+};
+
+// Parses the data lines in `body`, appending to `out_rows`. `first_line_no` and
+// `first_row_index` are the file line number and row index of the body's first line and
+// row; `out_line_count` receives the number of lines read, up to the first bad one.
+// Stops after `max_rows` rows; `out_consumed`, if set, receives the bytes read.
+bool parse_body(std::string_view body,
+                std::size_t first_line_no,
+                std::size_t first_row_index,
+                std::vector<ReplayRow>& out_rows,
+                std::size_t& out_line_count,
+                std::string& out_error,
+                std::size_t max_rows = std::numeric_limits<std::size_t>::max(),
+                std::size_t* out_consumed = nullptr) {
+    LineReader reader(body);
+    std::string_view line;
+    Fields fields;
+    std::size_t field_count = 0;
+    std::string split_error;
+    std::size_t row_index = first_row_index;
+    std::size_t line_no = first_line_no - 1;
+    out_line_count = 0;
+    std::size_t rows_left = max_rows;
+    while (rows_left > 0 && reader.next(line)) {
+        ++line_no;
+        ++out_line_count;
+        if (trim_view(line).empty()) {
+            continue;
+        }
+
+        if (!reader.split(line, fields, field_count, split_error)) {
+            out_error = line_error(line_no, split_error);
+            return false;
+        }
+        if (row_index >= kMaxReplayRows) {
+            out_error = line_error(line_no, "too many data rows for one replay file");
+            return false;
+        }
+
+        ReplayRow row;
+        if (!parse_row(fields, field_count, line_no, row_index, row, out_error)) {
+            return false;
+        }
+
+        out_rows.push_back(row);
+        ++row_index;
+        --rows_left;
+    }
+    if (out_consumed != nullptr) {
+        *out_consumed = reader.consumed();
+    }
+    return true;
+}
+
+// Runs `work(0) .. work(count - 1)` concurrently, `work(0)` on the calling thread.
+template <typename Work>
+void run_parallel(std::size_t count, Work&& work) {
+    std::vector<std::thread> workers;
+    workers.reserve(count - 1);
+    for (std::size_t i = 1; i < count; ++i) {
+        workers.emplace_back([&work, i] { work(i); });
+    }
+    work(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+struct BodyChunk {
+    std::string_view text;
+    std::vector<ReplayRow> rows;
+    std::size_t line_count = 0;
+    bool ok = true;
+};
+
+// Cuts `body` into up to `count` pieces, each ending just after a newline (or at the end).
+std::vector<BodyChunk> split_body(std::string_view body, std::size_t count) {
+    std::vector<BodyChunk> chunks;
+    chunks.reserve(count);
+    std::size_t chunk_start = 0;
+    for (std::size_t i = 1; i <= count && chunk_start < body.size(); ++i) {
+        std::size_t chunk_end = body.size();
+        if (i < count) {
+            const std::size_t target = std::max(chunk_start, body.size() / count * i);
+            const std::size_t newline = body.find('\n', target);
+            chunk_end = newline == std::string_view::npos ? body.size() : newline + 1;
+        }
+        BodyChunk chunk;
+        chunk.text = body.substr(chunk_start, chunk_end - chunk_start);
+        chunks.push_back(std::move(chunk));
+        chunk_start = chunk_end;
+    }
+    return chunks;
+}
+
+std::size_t resolve_thread_count(const ReplayParseOptions& options, std::size_t body_size) {
+    std::size_t threads = options.thread_count;
+    if (threads == 0) {
+        threads = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+    }
+    const std::size_t min_chunk_bytes = std::max<std::size_t>(1, options.min_chunk_bytes);
+    return std::max<std::size_t>(1, std::min(threads, body_size / min_chunk_bytes));
+}
+
+// Maps `csv_path`, checks its header and points `out_body` at the lines after it.
+bool open_replay_csv(const std::string& csv_path,
+                     MappedFile& file,
+                     std::string_view& out_body,
+                     std::string& out_error) {
+    std::string open_error;
+    if (!file.open(csv_path, open_error)) {
         out_error = "failed to open CSV file: " + csv_path;
         return false;
     }
 
-    std::string line;
-    std::vector<std::string> fields;
-
-    if (!std::getline(input, line)) {
+    const std::string_view text = file.view();
+    if (text.empty()) {
         out_error = "CSV file is empty";
         return false;
     }
 
+    LineReader header_reader(text);
+    std::string_view line;
+    Fields fields;
+    std::size_t field_count = 0;
+    header_reader.next(line);
+
     std::string split_error;
-    if (!split_csv_line(line, fields, split_error)) {
+    if (!header_reader.split(line, fields, field_count, split_error)) {
         out_error = line_error(1, split_error);
         return false;
     }
 
-    if (!check_header(fields, out_error)) {
+    if (!check_header(fields, field_count, out_error)) {
         out_error = line_error(1, out_error);
         return false;
     }
 
-    std::size_t row_index = 0;
-    std::size_t line_no = 1;
-    while (std::getline(input, line)) {
-        ++line_no;
-        if (trim_copy(line).empty()) {
+    out_body = text.substr(header_reader.consumed());
+    return true;
+}
+
+// Below this many rows std::sort is as fast as setting up the radix passes.
+constexpr std::size_t kRadixSortMinRows = 1024;
+
+unsigned bit_width(std::uint64_t value) {
+    unsigned bits = 0;
+    while (value != 0) {
+        ++bits;
+        value >>= 1;
+    }
+    return bits;
+}
+
+// How a row packs into one sort key, most significant first: ts_ns, seq and row_index,
+// each rebased to its minimum and given just the bits its range needs, then the row's
+// current position. index_bits is 0 when rows are already in row_index order, since the
+// position then breaks ties the same way. The position makes every key unique and is what
+// the sort hands back.
+struct KeyLayout {
+    std::uint64_t min_ts;
+    std::uint64_t min_seq;
+    std::uint64_t min_index;
+    unsigned seq_bits;
+    unsigned index_bits;
+    unsigned position_bits;
+};
+
+// Keys that do not fit one word, such as nanosecond timestamps spanning a trading day over
+// millions of rows, go in two.
+__extension__ typedef unsigned __int128 WideKey;
+
+// Appends a `bits`-wide field below `key`; a field of zero width is left out entirely.
+template <typename Key>
+Key shift_in(Key key, unsigned bits, std::uint64_t field) {
+    return bits == 0 ? key : (key << bits) | field;
+}
+
+template <typename Key>
+Key pack_key(const ReplayRow& row, std::size_t position, const KeyLayout& layout) {
+    Key key = row.ts_ns - layout.min_ts;
+    key = shift_in(key, layout.seq_bits, row.seq - layout.min_seq);
+    key = shift_in(key, layout.index_bits, row.row_index - layout.min_index);
+    return shift_in(key, layout.position_bits, position);
+}
+
+// Keys are sorted up to 12 bits at a time, split evenly over as few passes as the key
+// needs: 4096 buckets keep each pass's histogram and write cursors in cache, and every pass
+// saved matters most for two-word keys.
+constexpr unsigned kMaxDigitBits = 12;
+constexpr std::size_t kMaxDigitBuckets = std::size_t{1} << kMaxDigitBits;
+
+template <typename Key>
+unsigned key_digit(Key key, unsigned shift, unsigned digit_mask) {
+    return static_cast<unsigned>(key >> shift) & digit_mask;
+}
+
+// Stable LSD radix sort of packed keys on their `sort_bits` bits above the position;
+// returns the positions in sorted order. All digit histograms come from the pass that
+// builds the keys, and a digit that is the same in every key costs no pass at all.
+template <typename Key>
+std::vector<std::uint32_t> radix_sort_order(const std::vector<ReplayRow>& rows,
+                                            const KeyLayout& layout,
+                                            unsigned sort_bits) {
+    const std::size_t count = rows.size();
+    const unsigned digit_count = std::max(1u, (sort_bits + kMaxDigitBits - 1) / kMaxDigitBits);
+    const unsigned digit_bits = std::max(1u, (sort_bits + digit_count - 1) / digit_count);
+    const unsigned digit_mask = (1u << digit_bits) - 1;
+    const std::size_t buckets = std::size_t{1} << digit_bits;
+
+    std::vector<Key> keys(count);
+    std::vector<std::size_t> histograms(digit_count * kMaxDigitBuckets, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        keys[i] = pack_key<Key>(rows[i], i, layout);
+        for (unsigned digit = 0; digit < digit_count; ++digit) {
+            ++histograms[digit * kMaxDigitBuckets +
+                         key_digit(keys[i], layout.position_bits + digit * digit_bits, digit_mask)];
+        }
+    }
+
+    std::vector<Key> scratch(count);
+    for (unsigned digit = 0; digit < digit_count; ++digit) {
+        const unsigned shift = layout.position_bits + digit * digit_bits;
+        std::size_t* const histogram = histograms.data() + digit * kMaxDigitBuckets;
+        if (histogram[key_digit(keys[0], shift, digit_mask)] == count) {
             continue;
         }
+        std::size_t offset = 0;
+        for (std::size_t bucket = 0; bucket < buckets; ++bucket) {
+            const std::size_t bucket_count = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucket_count;
+        }
+        for (const Key key : keys) {
+            scratch[histogram[key_digit(key, shift, digit_mask)]++] = key;
+        }
+        keys.swap(scratch);
+    }
 
-        if (!split_csv_line(line, fields, split_error)) {
-            out_error = line_error(line_no, split_error);
-            return false;
+    const std::uint64_t position_mask = (std::uint64_t{1} << layout.position_bits) - 1;
+    std::vector<std::uint32_t> order(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        order[i] = static_cast<std::uint32_t>(keys[i] & position_mask);
+    }
+    return order;
+}
+
+// Moves every row to its sorted slot in place by following the permutation's cycles;
+// `order` is consumed. Cheap when rows only move a short way, as in nearly sorted input,
+// but every step of a long cycle is a dependent cache miss.
+void permute_rows_in_place(std::vector<ReplayRow>& rows, std::vector<std::uint32_t>& order) {
+    for (std::size_t start = 0; start < rows.size(); ++start) {
+        if (order[start] == start) {
+            continue;
         }
+        const ReplayRow held = rows[start];
+        std::size_t slot = start;
+        while (true) {
+            const std::size_t source = order[slot];
+            order[slot] = static_cast<std::uint32_t>(slot);
+            if (source == start) {
+                rows[slot] = held;
+                break;
+            }
+            rows[slot] = rows[source];
+            slot = source;
+        }
+    }
+}
 
-        ReplayRow row;
-        if (!parse_row(fields, line_no, row_index, row, out_error)) {
+// Copies rows out in sorted order. The reads are independent, so fetching ahead overlaps
+// the misses of a scattered permutation, at the cost of faulting in a second array.
+void gather_rows(std::vector<ReplayRow>& rows, const std::vector<std::uint32_t>& order) {
+    constexpr std::size_t kPrefetchDistance = 16;
+    std::vector<ReplayRow> sorted_rows;
+    sorted_rows.reserve(rows.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        if (i + kPrefetchDistance < order.size()) {
+            __builtin_prefetch(&rows[order[i + kPrefetchDistance]]);
+        }
+        sorted_rows.push_back(rows[order[i]]);
+    }
+    rows.swap(sorted_rows);
+}
+
+// A row that moves less than this many slots stays within roughly L2 of its destination.
+constexpr std::size_t kNearbyRowDistance = 4096;
+
+bool mostly_nearby(const std::vector<std::uint32_t>& order) {
+    std::size_t nearby = 0;
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        const std::size_t source = order[i];
+        nearby += (source > i ? source - i : i - source) < kNearbyRowDistance ? 1 : 0;
+    }
+    return nearby >= order.size() - order.size() / 16;
+}
+
+}  // namespace
+
+bool parse_replay_csv_rows(const std::string& csv_path,
+                           std::vector<ReplayRow>& out_rows,
+                           std::string& out_error,
+                           const ReplayParseOptions& options) {
+    out_rows.clear();
+
+    MappedFile file;
+    std::string_view body;
+    if (!open_replay_csv(csv_path, file, body, out_error)) {
+        return false;
+    }
+
+    const std::size_t thread_count = resolve_thread_count(options, body.size());
+    std::size_t line_count = 0;
+    if (thread_count == 1) {
+        return parse_body(body, 2, 0, out_rows, line_count, out_error);
+    }
+
+    // Chunks are parsed independently with chunk-local line numbers and row indexes. The
+    // first failing chunk in file order is then re-parsed with its real line number so the
+    // error reads as it would from a sequential pass, and row indexes are shifted by the
+    // rows of the chunks before them. A chunk that would take the file past kMaxReplayRows is
+    // re-parsed the same way to report the first row over the limit.
+    std::vector<BodyChunk> chunks = split_body(body, thread_count);
+    run_parallel(chunks.size(), [&chunks](std::size_t i) {
+        BodyChunk& chunk = chunks[i];
+        std::string chunk_error;
+        chunk.ok = parse_body(chunk.text, 1, 0, chunk.rows, chunk.line_count, chunk_error);
+    });
+
+    std::vector<std::size_t> first_row_index(chunks.size(), 0);
+    std::size_t line_no = 2;
+    std::size_t row_count = 0;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        if (!chunks[i].ok || row_count + chunks[i].rows.size() > kMaxReplayRows) {
+            std::vector<ReplayRow> discarded;
+            parse_body(chunks[i].text, line_no, row_count, discarded, line_count, out_error);
             return false;
         }
+        first_row_index[i] = row_count;
+        line_no += chunks[i].line_count;
+        row_count += chunks[i].rows.size();
+    }
+
+    out_rows.resize(row_count);
+    run_parallel(chunks.size(), [&](std::size_t i) {
+        std::vector<ReplayRow>& rows = chunks[i].rows;
+        ReplayRow* const out = out_rows.data() + first_row_index[i];
+        for (std::size_t j = 0; j < rows.size(); ++j) {
+            out[j] = rows[j];
+            out[j].row_index += static_cast<std::uint32_t>(first_row_index[i]);
+        }
+        std::vector<ReplayRow>().swap(rows);
+    });
+    return true;
+}
 
-        out_rows.push_back(row);
-        ++row_index;
+bool ReplayCsvReader::open(const std::string& csv_path, std::string& out_error) {
+    body_ = std::string_view();
+    cursor_ = 0;
+    released_ = 0;
+    next_line_no_ = 2;
+    next_row_index_ = 0;
+    return open_replay_csv(csv_path, file_, body_, out_error);
+}
+
+bool ReplayCsvReader::read(std::vector<ReplayRow>& out_rows, std::size_t max_rows, std::string& out_error) {
+    std::size_t line_count = 0;
+    std::size_t consumed = 0;
+    const std::size_t rows_before = out_rows.size();
+    if (!parse_body(body_.substr(cursor_), next_line_no_, next_row_index_, out_rows, line_count, out_error,
+                    max_rows, &consumed)) {
+        return false;
     }
+    cursor_ += consumed;
+    next_line_no_ += line_count;
+    next_row_index_ += out_rows.size() - rows_before;
 
+    // Hand parsed pages back so resident memory stays flat on large files.
+    constexpr std::size_t kReleaseBytes = std::size_t{8} << 20;
+    const auto body_offset = static_cast<std::size_t>(body_.data() - file_.data());
+    if (body_offset + cursor_ - released_ >= kReleaseBytes) {
+        released_ = body_offset + cursor_;
+        file_.release_before(released_);
+    }
     return true;
 }
 
 void sort_replay_rows(std::vector<ReplayRow>& rows) {
-    std::sort(rows.begin(), rows.end(), [](const ReplayRow& lhs, const ReplayRow& rhs) {
-        if (lhs.ts_ns != rhs.ts_ns) {
-            return lhs.ts_ns < rhs.ts_ns;
-        }
-        if (lhs.seq != rhs.seq) {
-            return lhs.seq < rhs.seq;
-        }
-        return lhs.row_index < rhs.row_index;
-    });
+    const std::size_t count = rows.size();
+    if (count < 2) {
+        return;
+    }
+
+    // One pass to find out whether there is anything to do, and the key ranges for the radix
+    // sort. Rows still in file order (row_index ascending) get row_index tie-breaking for
+    // free from the stable sort, so it stays out of the key.
+    bool sorted = true;
+    bool index_ascending = true;
+    std::uint64_t min_ts = rows[0].ts_ns;
+    std::uint64_t max_ts = rows[0].ts_ns;
+    std::uint64_t min_seq = rows[0].seq;
+    std::uint64_t max_seq = rows[0].seq;
+    std::uint64_t min_index = rows[0].row_index;
+    std::uint64_t max_index = rows[0].row_index;
+    for (std::size_t i = 1; i < count; ++i) {
+        const ReplayRow& row = rows[i];
+        sorted = sorted && !replay_row_before(row, rows[i - 1]);
+        index_ascending = index_ascending && row.row_index > rows[i - 1].row_index;
+        min_ts = std::min<std::uint64_t>(min_ts, row.ts_ns);
+        max_ts = std::max<std::uint64_t>(max_ts, row.ts_ns);
+        min_seq = std::min<std::uint64_t>(min_seq, row.seq);
+        max_seq = std::max<std::uint64_t>(max_seq, row.seq);
+        min_index = std::min<std::uint64_t>(min_index, row.row_index);
+        max_index = std::max<std::uint64_t>(max_index, row.row_index);
+    }
+    if (sorted) {
+        return;
+    }
+    if (count < kRadixSortMinRows || count > std::numeric_limits<std::uint32_t>::max()) {
+        std::sort(rows.begin(), rows.end(), replay_row_before);
+        return;
+    }
+
+    // One-word keys when the fields fit, two otherwise. Only ts_ns and seq ranges that
+    // together need about 64 bits or more leave the radix sort.
+    const KeyLayout layout{min_ts, min_seq, min_index, bit_width(max_seq - min_seq),
+                           index_ascending ? 0 : bit_width(max_index - min_index), bit_width(count - 1)};
+    const unsigned sort_bits = bit_width(max_ts - min_ts) + layout.seq_bits + layout.index_bits;
+    std::vector<std::uint32_t> order;
+    if (sort_bits + layout.position_bits <= 64) {
+        order = radix_sort_order<std::uint64_t>(rows, layout, sort_bits);
+    } else if (sort_bits + layout.position_bits <= 128) {
+        order = radix_sort_order<WideKey>(rows, layout, sort_bits);
+    } else {
+        std::sort(rows.begin(), rows.end(), replay_row_before);
+        return;
+    }
+    if (mostly_nearby(order)) {
+        permute_rows_in_place(rows, order);
+    } else {
+        gather_rows(rows, order);
+    }
 }
@@ -3,31 +3,87 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "mapped_file.h"
 #include "types.h"
 
-enum class ReplayAction { NEW, CANCEL, REPLACE };
+enum class ReplayAction : std::uint8_t { NEW, CANCEL, REPLACE };
 
+// One data row, packed so large replays stay small. NEW and REPLACE rows share the price
+// and quantity: a NEW row's limit price (0 for MARKET) and quantity, or a REPLACE row's new
+// price and new quantity; CANCEL rows leave them 0. side, type and tif only apply to NEW.
+// row_index is the row's position in its file; parsing rejects files with more rows than
+// it can hold. It has to be stored, not derived from where the row sits in a vector: the
+// sort moves rows, and merges and reorder-window errors still need the file position.
+// That, and 64-bit ts_ns, seq and price_ticks taken as the CSV gives them, is why the row
+// is 40 bytes rather than 32.
 struct ReplayRow {
     std::uint64_t ts_ns = 0;
     std::uint64_t seq = 0;
-    std::size_t row_index = 0;
-    ReplayAction action = ReplayAction::NEW;
-
+    PriceTicks price_ticks = 0;
+    std::uint32_t row_index = 0;
     int order_id = 0;
+    int quantity = 0;
+    ReplayAction action = ReplayAction::NEW;
     Side side = Side::BUY;
     OrderType type = OrderType::LIMIT;
-    PriceTicks price_ticks = 0;
-    int quantity = 0;
     TimeInForce tif = TimeInForce::GTC;
+};
+
+static_assert(sizeof(ReplayRow) == 40, "ReplayRow is sized for large in-memory replays");
 
-    PriceTicks new_price_ticks = 0;
-    int new_quantity = 0;
+// Data rows one file may hold, so every row_index fits in ReplayRow.
+constexpr std::size_t kMaxReplayRows = std::size_t{1} << 32;
+
+struct ReplayParseOptions {
+    // Threads parsing the body; 0 uses std::thread::hardware_concurrency().
+    std::size_t thread_count = 0;
+    // Each thread gets at least this much of the file, so small files stay single-threaded.
+    std::size_t min_chunk_bytes = std::size_t{1} << 20;
 };
 
+// Parses a replay CSV into rows in file order. The body is cut at newline boundaries and
+// the pieces are parsed concurrently; row indexes and the first error (in line order, with
+// its line number) are the same as a sequential read.
 bool parse_replay_csv_rows(const std::string& csv_path,
                            std::vector<ReplayRow>& out_rows,
-                           std::string& out_error);
+                           std::string& out_error,
+                           const ReplayParseOptions& options = {});
+
+// Reads a replay CSV a batch of rows at a time, in file order, for callers that do not
+// want the whole file in memory. Row indexes and error messages match parse_replay_csv_rows.
+class ReplayCsvReader {
+public:
+    // Maps the file and checks its header.
+    bool open(const std::string& csv_path, std::string& out_error);
+    // Appends up to `max_rows` rows to `out_rows`; returns false on a malformed line.
+    bool read(std::vector<ReplayRow>& out_rows, std::size_t max_rows, std::string& out_error);
+    bool done() const { return cursor_ >= body_.size(); }
+
+private:
+    MappedFile file_;
+    std::string_view body_;
+    std::size_t cursor_ = 0;
+    std::size_t released_ = 0;
+    std::size_t next_line_no_ = 2;
+    std::size_t next_row_index_ = 0;
+};
+
+// Replay order: (ts_ns, seq), then original file order.
+inline bool replay_row_before(const ReplayRow& lhs, const ReplayRow& rhs) {
+    if (lhs.ts_ns != rhs.ts_ns) {
+        return lhs.ts_ns < rhs.ts_ns;
+    }
+    if (lhs.seq != rhs.seq) {
+        return lhs.seq < rhs.seq;
+    }
+    return lhs.row_index < rhs.row_index;
+}
 
+// Sorts rows into replay_row_before order; the result is the same as a stable sort on it.
+// Returns after one pass when rows are already in order. Otherwise large inputs take a
+// radix sort on (ts_ns, seq, row_index) keys packed with a row position into 64 bits, or
+// 128 when the ranges need it, and move each row once; the rest use std::sort.
 void sort_replay_rows(std::vector<ReplayRow>& rows);
@@ -0,0 +1,213 @@
+#include "replay_trades.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "mapped_file.h"
+
+namespace {
+
+// Creates an empty file named `<path>.XXXXXX` next to `path`, with the permissions `path` has
+// (or would get if created), and returns its name. Returns an empty string when `path` is
+// something other than a regular file or a missing one, or when the directory does not let
+// a new file be created; the caller then writes `path` in place.
+std::string create_replacement_file(const std::string& path) {
+    struct stat existing {};
+    mode_t mode = 0;
+    if (::lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISREG(existing.st_mode)) {
+            return {};
+        }
+        mode = existing.st_mode & 0777;
+    } else if (errno == ENOENT) {
+        const mode_t mask = ::umask(0);
+        ::umask(mask);
+        mode = 0666 & ~mask;
+    } else {
+        return {};
+    }
+
+    std::string temp_path = path + ".XXXXXX";
+    const int fd = ::mkstemp(temp_path.data());
+    if (fd < 0) {
+        return {};
+    }
+    const bool ok = ::fchmod(fd, mode) == 0;
+    ::close(fd);
+    if (!ok) {
+        ::unlink(temp_path.c_str());
+        return {};
+    }
+    return temp_path;
+}
+
+}  // namespace
+
+TradeLogRecord to_trade_log_record(const ReplayTradeRecord& trade) {
+    TradeLogRecord record{};
+    record.ts_ns = trade.ts_ns;
+    record.seq = trade.seq;
+    record.price_ticks = trade.price_ticks;
+    record.buy_order_id = trade.buy_order_id;
+    record.sell_order_id = trade.sell_order_id;
+    record.quantity = trade.quantity;
+    return record;
+}
+
+ReplayTradeRecord from_trade_log_record(const TradeLogRecord& record) {
+    ReplayTradeRecord trade;
+    trade.ts_ns = record.ts_ns;
+    trade.seq = record.seq;
+    trade.buy_order_id = record.buy_order_id;
+    trade.sell_order_id = record.sell_order_id;
+    trade.price_ticks = record.price_ticks;
+    trade.quantity = record.quantity;
+    return trade;
+}
+
+bool read_trade_log(const std::string& path,
+                    std::vector<ReplayTradeRecord>& out_trades,
+                    std::string& out_error) {
+    out_trades.clear();
+
+    MappedFile file;
+    if (!file.open(path, out_error)) {
+        return false;
+    }
+
+    TradeLogHeader header{};
+    if (file.size() < sizeof(header)) {
+        out_error = "trade log is truncated: " + path;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, kTradeLogMagic, sizeof(header.magic)) != 0) {
+        out_error = "not a trade log file: " + path;
+        return false;
+    }
+    if (header.byte_order != kTradeLogByteOrder) {
+        out_error = "trade log was written with a different byte order: " + path;
+        return false;
+    }
+    if (header.version != kTradeLogVersion || header.record_size != sizeof(TradeLogRecord)) {
+        out_error = "unsupported trade log version " + std::to_string(header.version) + ": " + path;
+        return false;
+    }
+    if ((file.size() - sizeof(header)) % sizeof(TradeLogRecord) != 0) {
+        out_error = "trade log ends partway through a record: " + path;
+        return false;
+    }
+
+    const std::size_t count = (file.size() - sizeof(header)) / sizeof(TradeLogRecord);
+    out_trades.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        TradeLogRecord record;
+        std::memcpy(&record, file.data() + sizeof(header) + i * sizeof(record), sizeof(record));
+        out_trades.push_back(from_trade_log_record(record));
+    }
+    return true;
+}
+
+TradeOutputFormat trade_output_format_for(const std::string& path) {
+    const std::string_view extension = ".metl";
+    const bool is_log = path.size() >= extension.size() &&
+                        path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+    return is_log ? TradeOutputFormat::LOG : TradeOutputFormat::CSV;
+}
+
+ReplayTradeWriter::~ReplayTradeWriter() {
+    discard();
+}
+
+bool ReplayTradeWriter::open(const std::string& path, TradeOutputFormat format, std::string& out_error) {
+    discard();
+    format_ = format;
+    count_ = 0;
+    temp_path_ = create_replacement_file(path);
+    if (!output_.open(temp_path_.empty() ? path : temp_path_)) {
+        out_error = (format == TradeOutputFormat::CSV ? "failed to open output CSV for writing: "
+                                                       : "failed to open trade log for writing: ") +
+                    path;
+        if (!temp_path_.empty()) {
+            std::remove(temp_path_.c_str());
+            temp_path_.clear();
+        }
+        return false;
+    }
+    path_ = path;
+
+    if (format == TradeOutputFormat::CSV) {
+        output_.put("ts_ns,seq,buy_order_id,sell_order_id,price_ticks,price,quantity\n");
+    } else {
+        TradeLogHeader header{};
+        std::memcpy(header.magic, kTradeLogMagic, sizeof(header.magic));
+        header.version = kTradeLogVersion;
+        header.record_size = sizeof(TradeLogRecord);
+        header.byte_order = kTradeLogByteOrder;
+        output_.put(std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+    }
+    return true;
+}
+
+void ReplayTradeWriter::write(const ReplayTradeRecord& trade) {
+    ++count_;
+    if (format_ == TradeOutputFormat::LOG) {
+        const TradeLogRecord record = to_trade_log_record(trade);
+        output_.put(std::string_view(reinterpret_cast<const char*>(&record), sizeof(record)));
+        return;
+    }
+
+    output_.put_int(trade.ts_ns);
+    output_.put(',');
+    output_.put_int(trade.seq);
+    output_.put(',');
+    output_.put_int(trade.buy_order_id);
+    output_.put(',');
+    output_.put_int(trade.sell_order_id);
+    output_.put(',');
+    output_.put_int(trade.price_ticks);
+    output_.put(',');
+    output_.put_price(trade.price_ticks);
+    output_.put(',');
+    output_.put_int(trade.quantity);
+    output_.put('\n');
+}
+
+bool ReplayTradeWriter::close(std::string& out_error) {
+    if (path_.empty()) {
+        return true;
+    }
+    if (!output_.close()) {
+        out_error = (format_ == TradeOutputFormat::CSV ? "failed while writing output CSV: "
+                                                        : "failed while writing trade log: ") +
+                    path_;
+        discard();
+        return false;
+    }
+    if (!temp_path_.empty() && std::rename(temp_path_.c_str(), path_.c_str()) != 0) {
+        out_error = "failed to move " + temp_path_ + " to " + path_;
+        discard();
+        return false;
+    }
+    temp_path_.clear();
+    path_.clear();
+    return true;
+}
+
+void ReplayTradeWriter::discard() {
+    if (path_.empty()) {
+        return;
+    }
+    output_.close();
+    if (!temp_path_.empty()) {
+        std::remove(temp_path_.c_str());
+        temp_path_.clear();
+    }
+    path_.clear();
+}
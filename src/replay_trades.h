@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "csv_replay.h"
+#include "csv_writer.h"
+
+// Binary trade log (.metl): a fixed header followed by one fixed-width record per replay
+// trade, in host byte order and replay order. The record count follows from the file
+// length, so a log can be written as trades are produced.
+constexpr char kTradeLogMagic[4] = {'M', 'E', 'T', 'L'};
+constexpr std::uint16_t kTradeLogVersion = 1;
+constexpr std::uint32_t kTradeLogByteOrder = 0x01020304;
+
+struct TradeLogHeader {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t record_size;
+    // Reads back as kTradeLogByteOrder only on a host with the writer's byte order.
+    std::uint32_t byte_order;
+    std::uint32_t reserved;
+};
+
+struct TradeLogRecord {
+    std::uint64_t ts_ns;
+    std::uint64_t seq;
+    std::int64_t price_ticks;
+    std::int32_t buy_order_id;
+    std::int32_t sell_order_id;
+    std::int32_t quantity;
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(TradeLogHeader) == 16, "TradeLogHeader layout is part of the file format");
+static_assert(sizeof(TradeLogRecord) == 40, "TradeLogRecord layout is part of the file format");
+
+TradeLogRecord to_trade_log_record(const ReplayTradeRecord& trade);
+ReplayTradeRecord from_trade_log_record(const TradeLogRecord& record);
+
+// Reads a whole .metl file back into memory.
+bool read_trade_log(const std::string& path,
+                    std::vector<ReplayTradeRecord>& out_trades,
+                    std::string& out_error);
+
+enum class TradeOutputFormat {
+    CSV,
+    LOG,
+};
+
+// LOG for paths ending in ".metl", CSV otherwise.
+TradeOutputFormat trade_output_format_for(const std::string& path);
+
+// Writes replay trades to a file while the replay runs, through CsvWriter's block buffer,
+// so memory does not grow with the number of fills. The CSV format is the one
+// write_replay_trades_csv produces. When `path` is a regular file or does not exist yet,
+// trades go to a uniquely named temporary file beside it, which close() renames over `path`
+// only once every write has succeeded; a writer destroyed without a successful close()
+// removes the temporary file, so a failed replay never leaves a partial output. Anything
+// else (a symlink, FIFO or device such as /dev/stdout), or a directory that does not allow
+// the temporary file, is written in place.
+class ReplayTradeWriter {
+public:
+    ReplayTradeWriter() = default;
+    ~ReplayTradeWriter();
+
+    ReplayTradeWriter(const ReplayTradeWriter&) = delete;
+    ReplayTradeWriter& operator=(const ReplayTradeWriter&) = delete;
+
+    bool open(const std::string& path, TradeOutputFormat format, std::string& out_error);
+    void write(const ReplayTradeRecord& trade);
+    // Finishes the file and moves it to `path`; returns false, leaving `path` untouched
+    // unless it was written in place, if any write failed.
+    bool close(std::string& out_error);
+
+    std::size_t count() const { return count_; }
+
+private:
+    // Closes the output and removes the temporary file, if there is one.
+    void discard();
+
+    std::string path_;
+    std::string temp_path_;
+    TradeOutputFormat format_ = TradeOutputFormat::CSV;
+    CsvWriter output_;
+    std::size_t count_ = 0;
+};
@@ -5,9 +5,13 @@
 #include <optional>
 #include <vector>
 
-enum class Side { BUY, SELL };
-enum class TimeInForce { GTC, IOC };
-enum class OrderType { LIMIT, MARKET };
+enum class Side : std::uint8_t { BUY, SELL };
+enum class TimeInForce : std::uint8_t { GTC, IOC };
+enum class OrderType : std::uint8_t { LIMIT, MARKET };
+
+constexpr Side opposite(Side side) {
+    return side == Side::BUY ? Side::SELL : Side::BUY;
+}
 
 using PriceTicks = std::int64_t;
 constexpr PriceTicks kTicksPerUnit = 10000;
@@ -39,6 +43,7 @@ struct Trade {
 struct BookLevel {
     PriceTicks price_ticks;
     int quantity;
+    int order_count = 0;
 };
 
 struct TopOfBook {
@@ -51,20 +56,88 @@ struct BookSnapshot {
     std::vector<BookLevel> asks;
 };
 
-enum class BookEventType { ADD, TRADE, CANCEL, REPLACE };
+enum class BookEventType : std::uint8_t { ADD, TRADE, CANCEL, REPLACE };
 
+// Packed event record (40 bytes): fields shared by every type are stored directly,
+// the rest overlay in a union selected by `type`. Accessors return std::nullopt for
+// fields the event type does not carry.
 struct BookEvent {
     std::uint64_t seq_num = 0;
     BookEventType type = BookEventType::ADD;
 
-    std::optional<int> order_id;
-    std::optional<Side> side;
-    std::optional<PriceTicks> price_ticks;
-    std::optional<int> quantity;
+    static BookEvent add(const Order& order) { return resting(BookEventType::ADD, order); }
+    static BookEvent cancel(const Order& order) { return resting(BookEventType::CANCEL, order); }
+    static BookEvent trade(const Trade& trade) {
+        BookEvent event;
+        event.type = BookEventType::TRADE;
+        event.price_ticks_ = trade.price_ticks;
+        event.quantity_ = trade.quantity;
+        event.payload_.trade = {trade.buy_order_id, trade.sell_order_id};
+        return event;
+    }
+    static BookEvent replace(const Order& old_order, const Order& new_order) {
+        BookEvent event = resting(BookEventType::REPLACE, new_order);
+        event.payload_.replace = {old_order.id, old_order.quantity, old_order.price_ticks};
+        event.side_ = static_cast<std::uint8_t>(old_order.side);
+        return event;
+    }
+
+    std::optional<int> order_id() const {
+        if (type == BookEventType::TRADE) {
+            return std::nullopt;
+        }
+        return type == BookEventType::REPLACE ? payload_.replace.order_id : payload_.order_id;
+    }
+    std::optional<Side> side() const {
+        return type == BookEventType::TRADE ? std::nullopt : std::optional<Side>(static_cast<Side>(side_));
+    }
+    std::optional<PriceTicks> price_ticks() const { return price_ticks_; }
+    std::optional<int> quantity() const { return quantity_; }
+
+    std::optional<int> buy_order_id() const {
+        return type == BookEventType::TRADE ? std::optional<int>(payload_.trade.buy_order_id) : std::nullopt;
+    }
+    std::optional<int> sell_order_id() const {
+        return type == BookEventType::TRADE ? std::optional<int>(payload_.trade.sell_order_id) : std::nullopt;
+    }
+
+    std::optional<PriceTicks> old_price_ticks() const {
+        return type == BookEventType::REPLACE ? std::optional<PriceTicks>(payload_.replace.old_price_ticks)
+                                              : std::nullopt;
+    }
+    std::optional<int> old_quantity() const {
+        return type == BookEventType::REPLACE ? std::optional<int>(payload_.replace.old_quantity) : std::nullopt;
+    }
+
+private:
+    static BookEvent resting(BookEventType type, const Order& order) {
+        BookEvent event;
+        event.type = type;
+        event.side_ = static_cast<std::uint8_t>(order.side);
+        event.price_ticks_ = order.price_ticks;
+        event.quantity_ = order.quantity;
+        event.payload_.order_id = order.id;
+        return event;
+    }
 
-    std::optional<int> buy_order_id;
-    std::optional<int> sell_order_id;
+    struct TradeIds {
+        int buy_order_id;
+        int sell_order_id;
+    };
+    struct ReplaceFields {
+        int order_id;
+        int old_quantity;
+        PriceTicks old_price_ticks;
+    };
+    union Payload {
+        int order_id;
+        TradeIds trade;
+        ReplaceFields replace;
+    };
 
-    std::optional<PriceTicks> old_price_ticks;
-    std::optional<int> old_quantity;
+    // Packs into the padding after `type`.
+    std::uint8_t side_ = 0;
+    int quantity_ = 0;
+    PriceTicks price_ticks_ = 0;
+    Payload payload_{};
 };
@@ -1,7 +1,24 @@
+#include <sys/stat.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "csv_replay.h"
+#include "csv_scan.h"
+#include "order_flow_generator.h"
+#include "price_parse.h"
+#include "replay_bench.h"
+#include "replay_binary.h"
+#include "replay_trades.h"
 
 #ifndef TEST_DATA_DIR
 #define TEST_DATA_DIR "tests/data"
@@ -31,6 +48,72 @@ void assert_trade_matches(const ReplayTradeRecord& trade,
 }  // namespace
 
 int main() {
+    struct DecimalCase {
+        const char* text;
+        PriceTicks ticks;
+    };
+    const DecimalCase valid_decimals[] = {
+        {"100.2500", 1002500},
+        {"100.25", 1002500},
+        {"+7", 70000},
+        {".5", 5000},
+        {"12.", 120000},
+        {"-0.0001", -1},
+        {"1.000100", 10001},
+        {"922337203685477.5807", 9223372036854775807LL},
+        {"-922337203685477.5808", -9223372036854775807LL - 1},
+        // Exact for magnitudes where the double path could round.
+        {"90071992547409.9993", 900719925474099993LL},
+    };
+    for (const DecimalCase& decimal : valid_decimals) {
+        PriceTicks ticks = 0;
+        const bool parsed = parse_decimal_price_ticks(decimal.text, ticks);
+        assert(parsed && ticks == decimal.ticks);
+    }
+    for (const char* text : {"922337203685477.5808", "99999999999999999999", "100.00001", "", ".", "-", "1e2",
+                             "1.2.3", "10 0", "inf"}) {
+        PriceTicks ticks = 0;
+        const bool parsed = parse_decimal_price_ticks(text, ticks);
+        assert(!parsed);
+    }
+
+    {
+        // Every vector kernel must agree with the scalar scan, at every alignment and tail length.
+        const char alphabet[] = {'a', '1', ',', ',', '"', '\n', ' ', '.'};
+        std::string text;
+        std::uint32_t state = 12345;
+        for (int i = 0; i < 4096; ++i) {
+            state = state * 1103515245u + 12345u;
+            text.push_back(alphabet[(state >> 16) % sizeof(alphabet)]);
+        }
+        std::uint32_t expected_offsets[4];
+        std::uint32_t offsets[4];
+        for (const CsvScanKernel kernel : {CsvScanKernel::SSE2, CsvScanKernel::AVX2}) {
+            if (!csv_scan_kernel_supported(kernel)) {
+                continue;
+            }
+            for (std::size_t start = 0; start < 512; ++start) {
+                for (std::size_t length = 0; length <= 160; length += 7) {
+                    const char* begin = text.data() + start;
+                    const CsvLineScan expected =
+                        scan_csv_line(CsvScanKernel::SCALAR, begin, begin + length, expected_offsets, 4);
+                    const CsvLineScan scan = scan_csv_line(kernel, begin, begin + length, offsets, 4);
+                    assert(scan.length == expected.length);
+                    assert(scan.comma_count == expected.comma_count);
+                    assert(scan.has_quote == expected.has_quote);
+                    for (std::size_t i = 0; i < std::min<std::size_t>(scan.comma_count, 4); ++i) {
+                        assert(offsets[i] == expected_offsets[i]);
+                    }
+                }
+            }
+        }
+
+        const std::string line = "1,2,\"x\"\nrest";
+        const CsvLineScan scan = scan_csv_line(line.data(), line.data() + line.size(), offsets, 4);
+        assert(scan.length == 7 && scan.comma_count == 2 && scan.has_quote);
+        assert(offsets[0] == 1 && offsets[1] == 3);
+    }
+
     const std::string replay_path = data_path("replay_basic.csv");
 
     MatchingEngine first_engine;
@@ -79,6 +162,292 @@ int main() {
         assert(lhs.quantity == rhs.quantity);
     }
 
+    // Streaming replay restores replay order through the reorder window and matches the full sort.
+    ReplayOptions streaming;
+    streaming.streaming = true;
+    for (const std::string& path : {replay_path, data_path("backtest_vwap_profile.csv")}) {
+        MatchingEngine sorted_engine;
+        ReplayResult sorted_result;
+        const bool sorted_ok = replay_csv_file(path, sorted_engine, sorted_result, error);
+        assert(sorted_ok);
+        MatchingEngine streamed_engine;
+        ReplayResult streamed_result;
+        const bool streamed_ok = replay_csv_file(path, streamed_engine, streamed_result, error, streaming);
+        assert(streamed_ok);
+        assert(streamed_result.stats.rows_processed == sorted_result.stats.rows_processed);
+        assert(streamed_result.stats.accepted_actions == sorted_result.stats.accepted_actions);
+        assert(streamed_result.stats.cancel_success == sorted_result.stats.cancel_success);
+        assert(streamed_result.stats.trades_generated == sorted_result.stats.trades_generated);
+        assert(streamed_result.trades.size() == sorted_result.trades.size());
+        for (std::size_t i = 0; i < streamed_result.trades.size(); ++i) {
+            assert(streamed_result.trades[i].ts_ns == sorted_result.trades[i].ts_ns);
+            assert(streamed_result.trades[i].seq == sorted_result.trades[i].seq);
+            assert(streamed_result.trades[i].buy_order_id == sorted_result.trades[i].buy_order_id);
+            assert(streamed_result.trades[i].sell_order_id == sorted_result.trades[i].sell_order_id);
+            assert(streamed_result.trades[i].quantity == sorted_result.trades[i].quantity);
+        }
+        assert(streamed_engine.last_seq_num() == sorted_engine.last_seq_num());
+    }
+
+    // replay_basic.csv lists seq 2 before seq 1 at ts 100, so a zero window cannot replay it.
+    streaming.reorder_window = 0;
+    MatchingEngine strict_engine;
+    ReplayResult strict_result;
+    const bool strict_ok = replay_csv_file(replay_path, strict_engine, strict_result, error, streaming);
+    assert(!strict_ok);
+    assert(error == "data row 2 is out of (ts_ns, seq) order by more than the reorder window of 0 rows");
+    streaming.reorder_window = 1;
+    MatchingEngine one_row_engine;
+    const bool one_row_ok = replay_csv_file(replay_path, one_row_engine, strict_result, error, streaming);
+    assert(one_row_ok);
+    assert(strict_result.trades.size() == first_result.trades.size());
+
+    // Merged replay: replay_basic.csv dealt two rows at a time into two files (found by a glob) replays
+    // like the original, since none of its rows share a (ts_ns, seq).
+    const std::filesystem::path merge_dir = std::filesystem::temp_directory_path();
+    {
+        std::ifstream basic(replay_path);
+        std::string line;
+        std::getline(basic, line);
+        std::ofstream part_a(merge_dir / "matching_engine_merge_a.csv");
+        std::ofstream part_b(merge_dir / "matching_engine_merge_b.csv");
+        part_a << line << '\n';
+        part_b << line << '\n';
+        for (std::size_t i = 0; std::getline(basic, line); ++i) {
+            ((i / 2) % 2 == 0 ? part_a : part_b) << line << '\n';
+        }
+    }
+    std::vector<std::string> merge_paths;
+    const bool expanded =
+        expand_replay_paths({(merge_dir / "matching_engine_merge_*.csv").string()}, merge_paths, error);
+    assert(expanded);
+    assert(merge_paths.size() == 2);
+    assert(merge_paths[0] == (merge_dir / "matching_engine_merge_a.csv").string());
+    MatchingEngine merged_engine;
+    ReplayResult merged_result;
+    const bool merged_ok = replay_csv_files(merge_paths, merged_engine, merged_result, error);
+    assert(merged_ok);
+    assert(merged_result.stats.rows_processed == first_result.stats.rows_processed);
+    assert(merged_result.stats.cancel_success == first_result.stats.cancel_success);
+    assert(merged_result.trades.size() == first_result.trades.size());
+    for (std::size_t i = 0; i < merged_result.trades.size(); ++i) {
+        assert(merged_result.trades[i].seq == first_result.trades[i].seq);
+        assert(merged_result.trades[i].buy_order_id == first_result.trades[i].buy_order_id);
+        assert(merged_result.trades[i].sell_order_id == first_result.trades[i].sell_order_id);
+        assert(merged_result.trades[i].quantity == first_result.trades[i].quantity);
+    }
+    assert(merged_engine.last_seq_num() == first_engine.last_seq_num());
+
+    // Each file has its own window; the error names the file that broke it.
+    ReplayOptions strict_merge;
+    strict_merge.reorder_window = 0;
+    MatchingEngine strict_merge_engine;
+    const bool strict_merge_ok = replay_csv_files(merge_paths, strict_merge_engine, merged_result, error, strict_merge);
+    assert(!strict_merge_ok);
+    assert(error == merge_paths[0] + ": data row 2 is out of (ts_ns, seq) order by more than the reorder window of 0 rows");
+    for (const std::string& path : merge_paths) {
+        std::filesystem::remove(path);
+    }
+    const bool expanded_after_remove =
+        expand_replay_paths({(merge_dir / "matching_engine_merge_*.csv").string()}, merge_paths, error);
+    assert(!expanded_after_remove);
+
+    // The trades CSV prints prices exactly as std::fixed << std::setprecision(4) would,
+    // including negative, sub-unit and very large tick counts.
+    {
+        std::vector<ReplayTradeRecord> trades;
+        std::ostringstream expected;
+        expected << "ts_ns,seq,buy_order_id,sell_order_id,price_ticks,price,quantity\n";
+        for (const PriceTicks price_ticks : {PriceTicks{0}, PriceTicks{1}, PriceTicks{-1}, PriceTicks{1002500},
+                                             PriceTicks{-99999}, PriceTicks{999999999999999},
+                                             PriceTicks{1234567890123456789}, PriceTicks{-9223372036854775807LL - 1}}) {
+            trades.push_back({18446744073709551615ULL, 7, 1, 2, price_ticks, 3});
+            expected << trades.back().ts_ns << ",7,1,2," << price_ticks << ',' << std::fixed
+                     << std::setprecision(4) << ticks_to_price(price_ticks) << ",3\n";
+        }
+        const std::filesystem::path trades_path =
+            std::filesystem::temp_directory_path() / "matching_engine_trades_format.csv";
+        const bool trades_written = write_replay_trades_csv(trades_path.string(), trades, error);
+        assert(trades_written);
+        std::ifstream written(trades_path, std::ios::binary);
+        std::ostringstream contents;
+        contents << written.rdbuf();
+        assert(contents.str() == expected.str());
+        std::filesystem::remove(trades_path);
+    }
+
+    // A trade writer takes the fills as they happen: ReplayResult::trades stays empty, stats
+    // are unchanged, and the file matches write_replay_trades_csv (or reads back from .metl).
+    for (const TradeOutputFormat format : {TradeOutputFormat::CSV, TradeOutputFormat::LOG}) {
+        const bool is_log = format == TradeOutputFormat::LOG;
+        const std::filesystem::path streamed_path =
+            std::filesystem::temp_directory_path() /
+            (is_log ? "matching_engine_trades_streamed.metl" : "matching_engine_trades_streamed.csv");
+        assert(trade_output_format_for(streamed_path.string()) == format);
+
+        ReplayTradeWriter writer;
+        const bool opened = writer.open(streamed_path.string(), format, error);
+        assert(opened);
+        ReplayOptions sink_options;
+        sink_options.trade_writer = &writer;
+        MatchingEngine sink_engine;
+        ReplayResult sink_result;
+        const bool sink_ok = replay_csv_file(replay_path, sink_engine, sink_result, error, sink_options);
+        assert(sink_ok);
+        const bool closed = writer.close(error);
+        assert(closed);
+        assert(sink_result.trades.empty());
+        assert(sink_result.stats.trades_generated == first_result.stats.trades_generated);
+        assert(sink_result.stats.rows_processed == first_result.stats.rows_processed);
+        assert(writer.count() == first_result.trades.size());
+
+        if (is_log) {
+            std::vector<ReplayTradeRecord> logged;
+            const bool logged_ok = read_trade_log(streamed_path.string(), logged, error);
+            assert(logged_ok);
+            assert(logged.size() == first_result.trades.size());
+            for (std::size_t i = 0; i < logged.size(); ++i) {
+                const ReplayTradeRecord& expected = first_result.trades[i];
+                assert_trade_matches(logged[i], expected.ts_ns, expected.seq, expected.buy_order_id,
+                                     expected.sell_order_id, expected.price_ticks, expected.quantity);
+            }
+            std::filesystem::resize_file(streamed_path, sizeof(TradeLogHeader) + sizeof(TradeLogRecord) + 1);
+            const bool truncated_ok = read_trade_log(streamed_path.string(), logged, error);
+            assert(!truncated_ok);
+            assert(error.find("partway through a record") != std::string::npos);
+        } else {
+            const std::filesystem::path batch_path =
+                std::filesystem::temp_directory_path() / "matching_engine_trades_batch.csv";
+            const bool batch_written = write_replay_trades_csv(batch_path.string(), first_result.trades, error);
+            assert(batch_written);
+            std::ifstream streamed_file(streamed_path, std::ios::binary);
+            std::ifstream batch_file(batch_path, std::ios::binary);
+            std::ostringstream streamed_contents;
+            std::ostringstream batch_contents;
+            streamed_contents << streamed_file.rdbuf();
+            batch_contents << batch_file.rdbuf();
+            assert(streamed_contents.str() == batch_contents.str());
+            std::filesystem::remove(batch_path);
+        }
+        std::filesystem::remove(streamed_path);
+    }
+
+    // A writer dropped without close(), as on a failed replay, leaves an existing output as
+    // it was and removes its temporary file, which never reuses an existing `<path>.tmp`.
+    {
+        const std::filesystem::path kept_path =
+            std::filesystem::temp_directory_path() / "matching_engine_trades_kept.csv";
+        const std::string kept_prefix = kept_path.filename().string() + ".";
+        const auto count_siblings = [&kept_path, &kept_prefix]() {
+            std::size_t siblings = 0;
+            for (const auto& entry : std::filesystem::directory_iterator(kept_path.parent_path())) {
+                siblings += entry.path().filename().string().rfind(kept_prefix, 0) == 0 ? 1 : 0;
+            }
+            return siblings;
+        };
+        const bool kept_written = write_replay_trades_csv(kept_path.string(), first_result.trades, error);
+        assert(kept_written);
+        const auto kept_size = std::filesystem::file_size(kept_path);
+        const std::filesystem::path bystander_path = kept_path.string() + ".tmp";
+        {
+            std::ofstream bystander(bystander_path, std::ios::binary);
+            bystander << "not ours";
+        }
+        assert(count_siblings() == 1);
+        {
+            ReplayTradeWriter writer;
+            const bool kept_opened = writer.open(kept_path.string(), TradeOutputFormat::CSV, error);
+            assert(kept_opened);
+            writer.write(first_result.trades.front());
+            assert(count_siblings() == 2);
+        }
+        assert(count_siblings() == 1);
+        assert(std::filesystem::file_size(kept_path) == kept_size);
+        assert(std::filesystem::file_size(bystander_path) == 8);
+
+        // A symlinked output is written through the link, which stays in place.
+        const std::filesystem::path link_path =
+            std::filesystem::temp_directory_path() / "matching_engine_trades_link.csv";
+        std::filesystem::remove(link_path);
+        std::filesystem::create_symlink(kept_path, link_path);
+        {
+            ReplayTradeWriter writer;
+            const bool link_opened = writer.open(link_path.string(), TradeOutputFormat::CSV, error);
+            assert(link_opened);
+            writer.write(first_result.trades.front());
+            const bool link_closed = writer.close(error);
+            assert(link_closed);
+        }
+        assert(std::filesystem::is_symlink(link_path));
+        assert(std::filesystem::file_size(kept_path) < kept_size);
+        assert(count_siblings() == 1);
+        std::filesystem::remove(link_path);
+        std::filesystem::remove(bystander_path);
+        std::filesystem::remove(kept_path);
+    }
+
+    // The benchmark replays the same rows and trades, and orders its latency percentiles.
+    {
+        ReplayBenchResult bench;
+        const bool bench_ok = run_replay_bench(replay_path, ReplayBenchOptions{}, bench, error);
+        assert(bench_ok);
+        assert(bench.rows == first_result.stats.rows_processed);
+        assert(bench.trades == first_result.stats.trades_generated);
+        assert(bench.input_bytes > 0 && bench.peak_rss_bytes > 0);
+        assert(bench.latency_p50_ns <= bench.latency_p99_ns);
+        assert(bench.latency_p99_ns <= bench.latency_p999_ns);
+        assert(bench.latency_p999_ns <= bench.latency_max_ns);
+        assert(bench.event_log_mode == EventLogMode::OFF);
+
+        const std::filesystem::path json_path =
+            std::filesystem::temp_directory_path() / "matching_engine_bench.json";
+        const bool json_ok = write_replay_bench_json(json_path.string(), replay_path, bench, error);
+        assert(json_ok);
+        std::ifstream json_file(json_path, std::ios::binary);
+        std::ostringstream json;
+        json << json_file.rdbuf();
+        assert(json.str().find("\"rows\": 9,") != std::string::npos);
+        assert(json.str().find("\"trades\": 3,") != std::string::npos);
+        assert(json.str().find("\"event_log\": \"off\",") != std::string::npos);
+        std::filesystem::remove(json_path);
+
+        // Event capture changes what the match phase costs, not what it produces.
+        ReplayBenchOptions logged_options;
+        logged_options.engine.event_log_mode = EventLogMode::FULL;
+        logged_options.measure_latency = false;
+        ReplayBenchResult logged_bench;
+        const bool logged_bench_ok = run_replay_bench(replay_path, logged_options, logged_bench, error);
+        assert(logged_bench_ok);
+        assert(logged_bench.event_log_mode == EventLogMode::FULL);
+        assert(logged_bench.trades == bench.trades);
+
+        const bool invalid_bench_ok =
+            run_replay_bench(data_path("replay_invalid.csv"), ReplayBenchOptions{}, bench, error);
+        assert(!invalid_bench_ok);
+    }
+
+    // Pipes cannot be mapped: they are read into a buffer, and always as CSV.
+    {
+        const std::filesystem::path fifo_path = std::filesystem::temp_directory_path() / "matching_engine_replay.fifo";
+        std::filesystem::remove(fifo_path);
+        const int fifo_made = ::mkfifo(fifo_path.c_str(), 0600);
+        assert(fifo_made == 0);
+        std::thread feeder([&] {
+            std::ifstream source(replay_path, std::ios::binary);
+            std::ofstream fifo(fifo_path, std::ios::binary);
+            fifo << source.rdbuf();
+        });
+        MatchingEngine fifo_engine;
+        ReplayResult fifo_result;
+        assert(!is_replay_binary_file(fifo_path.string()));
+        const bool fifo_ok = replay_csv_file(fifo_path.string(), fifo_engine, fifo_result, error);
+        feeder.join();
+        assert(fifo_ok);
+        assert(fifo_result.stats.rows_processed == first_result.stats.rows_processed);
+        assert(fifo_result.trades.size() == first_result.trades.size());
+        std::filesystem::remove(fifo_path);
+    }
+
     MatchingEngine invalid_engine;
     ReplayResult invalid_result;
     const bool invalid_ok =
@@ -86,5 +455,291 @@ int main() {
     assert(!invalid_ok);
     assert(error.find("line 2") != std::string::npos);
 
+    // CRLF line endings, blank lines and quoted notes (embedded commas, doubled quotes).
+    const std::filesystem::path quirks_path =
+        std::filesystem::temp_directory_path() / "matching_engine_replay_quirks.csv";
+    {
+        std::ofstream quirks(quirks_path, std::ios::binary);
+        quirks << "ts_ns,seq,action,order_id,side,type,price,qty,tif,new_price,new_qty,notes\r\n"
+               << "100,1,NEW,7,BUY,LIMIT, 100.2500 ,+5,GTC,,,\"note, with \"\"quotes\"\"\"\r\n"
+               << "\r\n"
+               << "101,1,REPLACE,7,,,,,,100.5,3,\r\n"
+               << "102,1,CANCEL,7,,,,,,,,";
+    }
+    std::vector<ReplayRow> quirk_rows;
+    const bool quirks_ok = parse_replay_csv_rows(quirks_path.string(), quirk_rows, error);
+    assert(quirks_ok);
+    assert(quirk_rows.size() == 3);
+    assert(quirk_rows[0].price_ticks == price_to_ticks(100.25));
+    assert(quirk_rows[0].quantity == 5);
+    assert(quirk_rows[1].row_index == 1);
+    assert(quirk_rows[1].price_ticks == price_to_ticks(100.5) && quirk_rows[1].quantity == 3);
+    assert(quirk_rows[2].action == ReplayAction::CANCEL);
+
+    {
+        std::ofstream quirks(quirks_path, std::ios::binary);
+        quirks << "ts_ns,seq,action,order_id,side,type,price,qty,tif,new_price,new_qty,notes\n"
+               << "100,1,NEW,7,BUY,LIMIT,100,5,GTC,,,\n"
+               << "\n"
+               << "101,1,NEW,8,BUY,LIMIT,100,5,GTC,,,unquoted, comma\n";
+    }
+    const bool extra_comma_ok = parse_replay_csv_rows(quirks_path.string(), quirk_rows, error);
+    assert(!extra_comma_ok);
+    assert(error == "line 4: expected 12 columns, found 13");
+
+    // Chunked parsing: tiny chunks force many threads over the same file, which must give the
+    // sequential rows, row indexes and first error.
+    ReplayParseOptions chunked;
+    chunked.thread_count = 7;
+    chunked.min_chunk_bytes = 1;
+    {
+        std::ofstream quirks(quirks_path, std::ios::binary);
+        quirks << "ts_ns,seq,action,order_id,side,type,price,qty,tif,new_price,new_qty,notes\n";
+        for (int i = 0; i < 200; ++i) {
+            quirks << 100 + i % 3 << ',' << i << ",NEW," << i + 1 << ",BUY,LIMIT,100." << i % 10 << ',' << i + 1
+                   << ",GTC,,," << (i % 17 == 0 ? "\"a, b\"" : "") << '\n';
+            if (i % 50 == 0) {
+                quirks << "\n";
+            }
+        }
+    }
+    std::vector<ReplayRow> sequential_rows;
+    ReplayParseOptions sequential;
+    sequential.thread_count = 1;
+    const bool sequential_ok = parse_replay_csv_rows(quirks_path.string(), sequential_rows, error, sequential);
+    assert(sequential_ok);
+    const bool chunked_ok = parse_replay_csv_rows(quirks_path.string(), quirk_rows, error, chunked);
+    assert(chunked_ok);
+    assert(sequential_rows.size() == 200 && quirk_rows.size() == 200);
+    for (std::size_t i = 0; i < quirk_rows.size(); ++i) {
+        assert(quirk_rows[i].row_index == i);
+        assert(quirk_rows[i].row_index == sequential_rows[i].row_index);
+        assert(quirk_rows[i].seq == sequential_rows[i].seq);
+        assert(quirk_rows[i].order_id == sequential_rows[i].order_id);
+        assert(quirk_rows[i].price_ticks == sequential_rows[i].price_ticks);
+        assert(quirk_rows[i].quantity == sequential_rows[i].quantity);
+    }
+
+    {
+        std::ofstream quirks(quirks_path, std::ios::app | std::ios::binary);
+        quirks << "400,1,NEW,900,BUY,LIMIT,100,0,GTC,,,\n"
+               << "401,1,NEW,901,SIDEWAYS,LIMIT,100,1,GTC,,,\n";
+    }
+    const bool chunked_error_ok = parse_replay_csv_rows(quirks_path.string(), quirk_rows, error, chunked);
+    assert(!chunked_error_ok);
+    assert(error == "line 206: invalid qty (expected positive integer)");
+    std::filesystem::remove(quirks_path);
+
+    // .merb round trip: same rows as the sorted CSV, and replay reads it straight from the mapping.
+    const std::filesystem::path binary_path =
+        std::filesystem::temp_directory_path() / "matching_engine_replay_basic.merb";
+    std::vector<ReplayRow> csv_rows;
+    const bool csv_loaded = load_replay_rows(replay_path, csv_rows, error);
+    assert(csv_loaded);
+    const bool binary_written = write_replay_binary(binary_path.string(), csv_rows, error);
+    assert(binary_written);
+    assert(is_replay_binary_file(binary_path.string()));
+    assert(!is_replay_binary_file(replay_path));
+
+    ReplayBinaryFile binary;
+    const bool binary_opened = binary.open(binary_path.string(), error);
+    assert(binary_opened);
+    assert(binary.size() == csv_rows.size() && binary.sorted());
+    for (std::size_t i = 0; i < binary.size(); ++i) {
+        const ReplayRow row = binary[i];
+        assert(row.ts_ns == csv_rows[i].ts_ns && row.seq == csv_rows[i].seq);
+        assert(row.row_index == csv_rows[i].row_index && row.action == csv_rows[i].action);
+        assert(row.order_id == csv_rows[i].order_id && row.side == csv_rows[i].side);
+        assert(row.type == csv_rows[i].type && row.tif == csv_rows[i].tif);
+        assert(row.price_ticks == csv_rows[i].price_ticks && row.quantity == csv_rows[i].quantity);
+    }
+
+    MatchingEngine binary_engine;
+    ReplayResult binary_result;
+    const bool binary_ok = replay_csv_file(binary_path.string(), binary_engine, binary_result, error);
+    assert(binary_ok);
+    assert(binary_result.stats.rows_processed == first_result.stats.rows_processed);
+    assert(binary_result.stats.accepted_actions == first_result.stats.accepted_actions);
+    assert(binary_result.stats.cancel_success == first_result.stats.cancel_success);
+    assert(binary_result.trades.size() == first_result.trades.size());
+    for (std::size_t i = 0; i < binary_result.trades.size(); ++i) {
+        assert(binary_result.trades[i].seq == first_result.trades[i].seq);
+        assert(binary_result.trades[i].buy_order_id == first_result.trades[i].buy_order_id);
+        assert(binary_result.trades[i].price_ticks == first_result.trades[i].price_ticks);
+        assert(binary_result.trades[i].quantity == first_result.trades[i].quantity);
+    }
+    assert(binary_engine.last_seq_num() == first_engine.last_seq_num());
+
+    // open() applies the CSV parser's field checks and names the record that fails them; a
+    // MARKET order's price is not checked, as in the CSV.
+    {
+        const std::filesystem::path invalid_path =
+            std::filesystem::temp_directory_path() / "matching_engine_replay_invalid.merb";
+        ReplayRow market;
+        market.order_id = 1;
+        market.type = OrderType::MARKET;
+        market.quantity = 1;
+        ReplayRow limit = market;
+        limit.row_index = 1;
+        limit.order_id = 2;
+        limit.type = OrderType::LIMIT;
+        limit.price_ticks = PriceTicks{1000000};
+        ReplayRow replace = limit;
+        replace.action = ReplayAction::REPLACE;
+
+        std::vector<std::pair<ReplayRow, const char*>> invalid_cases;
+        invalid_cases.emplace_back(limit, "invalid order_id (expected positive integer)");
+        invalid_cases.back().first.order_id = 0;
+        invalid_cases.emplace_back(limit, "invalid price for LIMIT order");
+        invalid_cases.back().first.price_ticks = 0;
+        invalid_cases.emplace_back(limit, "invalid qty (expected positive integer)");
+        invalid_cases.back().first.quantity = 0;
+        invalid_cases.emplace_back(replace, "invalid new_price for REPLACE");
+        invalid_cases.back().first.price_ticks = -1;
+        invalid_cases.emplace_back(replace, "invalid new_qty for REPLACE");
+        invalid_cases.back().first.quantity = 0;
+        for (const auto& [row, expected_error] : invalid_cases) {
+            const bool invalid_written = write_replay_binary(invalid_path.string(), {market, row}, error);
+            assert(invalid_written);
+            const bool invalid_opened = binary.open(invalid_path.string(), error);
+            assert(!invalid_opened);
+            assert(error.find(std::string("record 1: ") + expected_error) == 0);
+        }
+        const bool valid_written = write_replay_binary(invalid_path.string(), {market, limit, replace}, error);
+        assert(valid_written);
+        const bool valid_opened = binary.open(invalid_path.string(), error);
+        assert(valid_opened);
+        std::filesystem::remove(invalid_path);
+    }
+
+    // Out-of-range enums and truncation are rejected at open().
+    {
+        std::fstream corrupt(binary_path, std::ios::in | std::ios::out | std::ios::binary);
+        corrupt.seekp(sizeof(ReplayBinaryHeader) + offsetof(ReplayBinaryRecord, side));
+        corrupt.put(static_cast<char>(7));
+    }
+    const bool corrupt_opened = binary.open(binary_path.string(), error);
+    assert(!corrupt_opened);
+    assert(error.find("record 0: invalid enum field") == 0);
+    std::filesystem::resize_file(binary_path, sizeof(ReplayBinaryHeader) + sizeof(ReplayBinaryRecord) / 2);
+    const bool truncated_opened = binary.open(binary_path.string(), error);
+    assert(!truncated_opened);
+    assert(error.find("length does not match") != std::string::npos);
+    std::filesystem::remove(binary_path);
+
+    // Generated flow: the same seed gives the same rows in CSV and .merb form, in replay
+    // order with the requested count, and both replay to the same result.
+    {
+        OrderFlowConfig flow;
+        flow.seed = 99;
+        flow.rows = 5000;
+        flow.max_live_orders = 64;
+        const std::filesystem::path flow_csv = std::filesystem::temp_directory_path() / "matching_engine_flow.csv";
+        const std::filesystem::path flow_binary =
+            std::filesystem::temp_directory_path() / "matching_engine_flow.merb";
+        assert(replay_file_format_for(flow_csv.string()) == ReplayFileFormat::CSV);
+        assert(replay_file_format_for(flow_binary.string()) == ReplayFileFormat::BINARY);
+        OrderFlowStats flow_stats;
+        const bool flow_csv_written =
+            write_order_flow(flow_csv.string(), flow, ReplayFileFormat::CSV, flow_stats, error);
+        assert(flow_csv_written);
+        assert(flow_stats.rows == flow.rows);
+        assert(flow_stats.new_orders + flow_stats.cancels + flow_stats.replaces == flow.rows);
+        assert(flow_stats.cancels > 0 && flow_stats.replaces > 0 && flow_stats.marketable_orders > 0);
+        const bool flow_binary_written =
+            write_order_flow(flow_binary.string(), flow, ReplayFileFormat::BINARY, flow_stats, error);
+        assert(flow_binary_written);
+
+        std::vector<ReplayRow> csv_flow;
+        std::vector<ReplayRow> binary_flow;
+        const bool flow_csv_parsed = parse_replay_csv_rows(flow_csv.string(), csv_flow, error);
+        assert(flow_csv_parsed);
+        const bool flow_binary_loaded = load_replay_rows(flow_binary.string(), binary_flow, error);
+        assert(flow_binary_loaded);
+        assert(csv_flow.size() == flow.rows && binary_flow.size() == flow.rows);
+        // The samplers are integer-only, so these totals hold on every platform.
+        std::int64_t quantity_total = 0;
+        std::int64_t price_total = 0;
+        for (const ReplayRow& row : csv_flow) {
+            quantity_total += row.quantity;
+            price_total += row.price_ticks;
+        }
+        assert(csv_flow.back().ts_ns == 51239079);
+        assert(quantity_total == 35034 && price_total == 3428433400);
+        OrderFlowGenerator regenerated(flow);
+        for (std::size_t i = 0; i < csv_flow.size(); ++i) {
+            const ReplayRow expected = regenerated.next();
+            for (const ReplayRow& row : {csv_flow[i], binary_flow[i]}) {
+                assert(row.ts_ns == expected.ts_ns && row.seq == expected.seq && row.row_index == i);
+                assert(row.action == expected.action && row.order_id == expected.order_id);
+                assert(row.price_ticks == expected.price_ticks && row.quantity == expected.quantity);
+                if (row.action == ReplayAction::NEW) {
+                    assert(row.side == expected.side && row.type == expected.type && row.tif == expected.tif);
+                }
+            }
+            assert(i == 0 || !replay_row_before(csv_flow[i], csv_flow[i - 1]));
+        }
+        assert(regenerated.done());
+
+        MatchingEngine csv_flow_engine;
+        MatchingEngine binary_flow_engine;
+        ReplayResult csv_flow_result;
+        ReplayResult binary_flow_result;
+        const bool csv_flow_ok = replay_csv_file(flow_csv.string(), csv_flow_engine, csv_flow_result, error);
+        assert(csv_flow_ok);
+        const bool binary_flow_ok =
+            replay_csv_file(flow_binary.string(), binary_flow_engine, binary_flow_result, error);
+        assert(binary_flow_ok);
+        assert(csv_flow_result.stats.rows_processed == flow.rows);
+        assert(csv_flow_result.stats.trades_generated > 0);
+        assert(csv_flow_result.stats.trades_generated == binary_flow_result.stats.trades_generated);
+        assert(csv_flow_result.stats.accepted_actions == binary_flow_result.stats.accepted_actions);
+        assert(csv_flow_engine.last_seq_num() == binary_flow_engine.last_seq_num());
+
+        OrderFlowConfig other_seed = flow;
+        other_seed.seed = 100;
+        assert(OrderFlowGenerator(other_seed).next().ts_ns != OrderFlowGenerator(flow).next().ts_ns);
+
+        OrderFlowConfig bad_mix = flow;
+        bad_mix.cancel_fraction = 0.8;
+        bad_mix.replace_fraction = 0.3;
+        const bool bad_mix_written =
+            write_order_flow(flow_csv.string(), bad_mix, ReplayFileFormat::CSV, flow_stats, error);
+        assert(!bad_mix_written);
+        assert(error.find("sum to at most 1") != std::string::npos);
+        std::filesystem::remove(flow_csv);
+        std::filesystem::remove(flow_binary);
+    }
+
+    // sort_replay_rows takes the radix path above 1024 rows; it must match a stable sort on the
+    // comparator whether row_index is in file order, scrambled, or the input is already sorted.
+    // Patterns 3 to 5 use epoch nanosecond timestamps over a 6.5 hour session, which need
+    // two-word keys, and then a seq range wide enough that even those do not fit.
+    for (int pattern = 0; pattern < 6; ++pattern) {
+        std::uint64_t ts_step = 1;
+        if (pattern == 3 || pattern == 4) {
+            ts_step = 38200000003ULL;
+        } else if (pattern == 5) {
+            ts_step = std::uint64_t{1} << 53;
+        }
+        std::vector<ReplayRow> rows(5000);
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            const std::uint64_t ts_base = pattern >= 3 ? 1700000000000000000ULL : 1000;
+            rows[i].ts_ns = pattern == 2 ? 1000 + i : ts_base + (i * 7919) % 613 * ts_step;
+            rows[i].seq = pattern == 2 ? 1 : (i * 31) % 3;
+            if (pattern >= 4) {
+                rows[i].seq <<= pattern == 4 ? 40 : 61;
+            }
+            rows[i].row_index = pattern == 1 || pattern >= 3 ? (i * 2654435761u) % 100003 : i;
+            rows[i].order_id = static_cast<int>(i);
+        }
+        std::vector<ReplayRow> expected = rows;
+        std::stable_sort(expected.begin(), expected.end(), replay_row_before);
+        sort_replay_rows(rows);
+        for (std::size_t i = 0; i < rows.size(); ++i) {
+            assert(rows[i].order_id == expected[i].order_id);
+        }
+    }
+
     return 0;
 }
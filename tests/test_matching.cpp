@@ -1,5 +1,9 @@
 #include <cassert>
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 
 #include "matching_engine.h"
 
@@ -9,6 +13,12 @@ PriceTicks px(double price) {
     return price_to_ticks(price);
 }
 
+// Advances the 64-bit LCG in `state` and returns a value below `bound` from its high bits.
+std::uint64_t next_random(std::uint64_t& state, std::uint64_t bound) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (state >> 33) % bound;
+}
+
 }  // namespace
 
 int main() {
@@ -78,14 +88,14 @@ int main() {
     assert(log0.size() == 1);
     assert(log0[0].seq_num == 1);
     assert(log0[0].type == BookEventType::ADD);
-    assert(log0[0].order_id.has_value());
-    assert(log0[0].order_id.value() == 800);
-    assert(log0[0].side.has_value());
-    assert(log0[0].side.value() == Side::BUY);
-    assert(log0[0].price_ticks.has_value());
-    assert(log0[0].price_ticks.value() == px(100.0));
-    assert(log0[0].quantity.has_value());
-    assert(log0[0].quantity.value() == 5);
+    assert(log0[0].order_id().has_value());
+    assert(log0[0].order_id().value() == 800);
+    assert(log0[0].side().has_value());
+    assert(log0[0].side().value() == Side::BUY);
+    assert(log0[0].price_ticks().has_value());
+    assert(log0[0].price_ticks().value() == px(100.0));
+    assert(log0[0].quantity().has_value());
+    assert(log0[0].quantity().value() == 5);
 
     auto e1 = event_engine.submit({801, Side::SELL, px(99.0), 2});
     assert(e1.accepted);
@@ -95,14 +105,18 @@ int main() {
     assert(log1.size() == 2);
     assert(log1[1].seq_num == 2);
     assert(log1[1].type == BookEventType::TRADE);
-    assert(log1[1].buy_order_id.has_value());
-    assert(log1[1].buy_order_id.value() == 800);
-    assert(log1[1].sell_order_id.has_value());
-    assert(log1[1].sell_order_id.value() == 801);
-    assert(log1[1].price_ticks.has_value());
-    assert(log1[1].price_ticks.value() == px(100.0));
-    assert(log1[1].quantity.has_value());
-    assert(log1[1].quantity.value() == 2);
+    assert(log1[1].buy_order_id().has_value());
+    assert(log1[1].buy_order_id().value() == 800);
+    assert(log1[1].sell_order_id().has_value());
+    assert(log1[1].sell_order_id().value() == 801);
+    assert(log1[1].price_ticks().has_value());
+    assert(log1[1].price_ticks().value() == px(100.0));
+    assert(log1[1].quantity().has_value());
+    assert(log1[1].quantity().value() == 2);
+    assert(!log1[1].order_id().has_value());
+    assert(!log1[1].side().has_value());
+    assert(!log1[1].old_price_ticks().has_value());
+    static_assert(sizeof(BookEvent) <= 40, "BookEvent should stay packed");
 
     auto e2 = event_engine.replace(800, px(100.0), 1);
     assert(e2.accepted);
@@ -111,16 +125,18 @@ int main() {
     assert(log2.size() == 3);
     assert(log2[2].seq_num == 3);
     assert(log2[2].type == BookEventType::REPLACE);
-    assert(log2[2].order_id.has_value());
-    assert(log2[2].order_id.value() == 800);
-    assert(log2[2].old_price_ticks.has_value());
-    assert(log2[2].old_price_ticks.value() == px(100.0));
-    assert(log2[2].old_quantity.has_value());
-    assert(log2[2].old_quantity.value() == 3);
-    assert(log2[2].price_ticks.has_value());
-    assert(log2[2].price_ticks.value() == px(100.0));
-    assert(log2[2].quantity.has_value());
-    assert(log2[2].quantity.value() == 1);
+    assert(log2[2].order_id().has_value());
+    assert(log2[2].order_id().value() == 800);
+    assert(log2[2].old_price_ticks().has_value());
+    assert(log2[2].old_price_ticks().value() == px(100.0));
+    assert(log2[2].old_quantity().has_value());
+    assert(log2[2].old_quantity().value() == 3);
+    assert(log2[2].price_ticks().has_value());
+    assert(log2[2].price_ticks().value() == px(100.0));
+    assert(log2[2].quantity().has_value());
+    assert(log2[2].quantity().value() == 1);
+    assert(log2[2].side().value() == Side::BUY);
+    assert(!log2[2].buy_order_id().has_value());
 
     assert(event_engine.cancel(800));
     assert(event_engine.last_seq_num() == 4);
@@ -128,10 +144,10 @@ int main() {
     assert(log3.size() == 4);
     assert(log3[3].seq_num == 4);
     assert(log3[3].type == BookEventType::CANCEL);
-    assert(log3[3].order_id.has_value());
-    assert(log3[3].order_id.value() == 800);
-    assert(log3[3].quantity.has_value());
-    assert(log3[3].quantity.value() == 1);
+    assert(log3[3].order_id().has_value());
+    assert(log3[3].order_id().value() == 800);
+    assert(log3[3].quantity().has_value());
+    assert(log3[3].quantity().value() == 1);
 
     auto e3 = event_engine.replace(99999, px(101.0), 1);
     assert(!e3.accepted);
@@ -155,10 +171,10 @@ int main() {
     assert(log4[6].type == BookEventType::REPLACE);
     assert(log4[7].seq_num == 8);
     assert(log4[7].type == BookEventType::TRADE);
-    assert(log4[7].buy_order_id.has_value());
-    assert(log4[7].buy_order_id.value() == 810);
-    assert(log4[7].sell_order_id.has_value());
-    assert(log4[7].sell_order_id.value() == 811);
+    assert(log4[7].buy_order_id().has_value());
+    assert(log4[7].buy_order_id().value() == 810);
+    assert(log4[7].sell_order_id().has_value());
+    assert(log4[7].sell_order_id().value() == 811);
 
     auto since_four = event_engine.events_since(4);
     assert(since_four.size() == 4);
@@ -192,6 +208,7 @@ int main() {
     assert(md_top1.best_bid.has_value());
     assert(md_top1.best_bid->price_ticks == px(101.0));
     assert(md_top1.best_bid->quantity == 5);
+    assert(md_top1.best_bid->order_count == 2);
     assert(md_top1.best_ask.has_value());
     assert(md_top1.best_ask->price_ticks == px(103.0));
     assert(md_top1.best_ask->quantity == 3);
@@ -207,12 +224,15 @@ int main() {
     assert(md_snapshot1.asks[0].quantity == 3);
     assert(md_snapshot1.asks[1].price_ticks == px(104.0));
     assert(md_snapshot1.asks[1].quantity == 5);
+    assert(md_snapshot1.asks[0].order_count == 2);
+    assert(md_snapshot1.asks[1].order_count == 1);
 
     assert(market_data_engine.cancel(501));
     auto md_top2 = market_data_engine.top_of_book();
     assert(md_top2.best_bid.has_value());
     assert(md_top2.best_bid->price_ticks == px(101.0));
     assert(md_top2.best_bid->quantity == 2);
+    assert(md_top2.best_bid->order_count == 1);
 
     auto md_replace = market_data_engine.replace(500, px(99.0), 2);
     assert(md_replace.accepted);
@@ -231,6 +251,7 @@ int main() {
     assert(md_top3.best_bid.has_value());
     assert(md_top3.best_bid->price_ticks == px(100.0));
     assert(md_top3.best_bid->quantity == 3);
+    assert(md_top3.best_bid->order_count == 1);
     assert(md_top3.best_ask.has_value());
     assert(md_top3.best_ask->price_ticks == px(103.0));
     assert(md_top3.best_ask->quantity == 3);
@@ -256,6 +277,8 @@ int main() {
     assert(keep_priority.reject_reason == RejectReason::NONE);
     assert(keep_priority.trades.empty());
     assert(replace_engine.has_order(50));
+    assert(replace_engine.top_of_book().best_bid->quantity == 7);
+    assert(replace_engine.top_of_book().best_bid->order_count == 2);
 
     auto priority_sell = replace_engine.submit({52, Side::SELL, px(100.0), 3});
     assert(priority_sell.accepted);
@@ -409,6 +432,516 @@ int main() {
     assert(market_sell_engine.bids().order_count() == 1);
     assert(!market_sell_engine.has_order(402));
 
+    MatchingEngine pool_engine;
+    auto p0 = pool_engine.submit({900, Side::BUY, px(100.0), 5});
+    assert(p0.accepted);
+    auto p1 = pool_engine.submit({901, Side::SELL, px(105.0), 5});
+    assert(p1.accepted);
+    const std::size_t bid_pool_growth = pool_engine.bids().order_pool().growth_count();
+    const std::size_t ask_pool_growth = pool_engine.asks().order_pool().growth_count();
+    const std::size_t index_growth = pool_engine.order_index().growth_count();
+    assert(bid_pool_growth > 0);
+    assert(ask_pool_growth > 0);
+
+    // Steady-state submit/cancel recycles pool nodes and index slots, so neither grows.
+    // Price levels and SubmitResult::trades still allocate and are not checked here.
+
+    for (int i = 0; i < 5000; ++i) {
+        const int buy_id = 10000 + 2 * i;
+        const int sell_id = buy_id + 1;
+        const SubmitResult bid = pool_engine.submit({buy_id, Side::BUY, px(99.0), 3});
+        assert(bid.accepted);
+        const SubmitResult ask = pool_engine.submit({sell_id, Side::SELL, px(101.0), 3});
+        assert(ask.accepted);
+        const bool bid_cancelled = pool_engine.cancel(buy_id);
+        assert(bid_cancelled);
+        const SubmitResult lift = pool_engine.submit({sell_id + 100000, Side::BUY, px(101.0), 3});
+        assert(lift.trades.size() == 1);
+    }
+    assert(pool_engine.bids().order_pool().growth_count() == bid_pool_growth);
+    assert(pool_engine.asks().order_pool().growth_count() == ask_pool_growth);
+    assert(pool_engine.order_index().growth_count() == index_growth);
+    assert(pool_engine.order_index().size() == 2);
+    assert(pool_engine.bids().order_pool().live_count() == 1);
+    assert(pool_engine.asks().order_pool().live_count() == 1);
+    assert(pool_engine.bids().best_order().id == 900);
+    assert(pool_engine.asks().best_order().id == 901);
+
+    OrderIndex index;
+    std::unordered_map<int, OrderNodeIndex> reference;
+    std::uint64_t index_lcg = 99;
+    for (int i = 0; i < 50000; ++i) {
+        const int id = static_cast<int>(next_random(index_lcg, 4096)) - 512;
+        const bool do_erase = next_random(index_lcg, 4) == 0;
+        if (do_erase) {
+            const bool erased = index.erase(id);
+            const bool reference_erased = reference.erase(id) == 1;
+            assert(erased == reference_erased);
+        } else {
+            const bool inserted = index.insert(id, Side::SELL, static_cast<OrderNodeIndex>(i));
+            const bool reference_inserted = reference.emplace(id, static_cast<OrderNodeIndex>(i)).second;
+            assert(inserted == reference_inserted);
+        }
+        assert(index.size() == reference.size());
+    }
+    for (const auto& [id, node] : reference) {
+        const OrderIndex::Entry* entry = index.find(id);
+        assert(entry != nullptr);
+        assert(entry->node == node);
+        assert(entry->side == Side::SELL);
+    }
+    assert(index.find(100000) == nullptr);
+
+    EngineConfig dense_config;
+    dense_config.book.ladder = LadderBackend::DENSE;
+    dense_config.book.dense_tick_size = px(0.01);
+    dense_config.book.dense_initial_levels = 8;
+    MatchingEngine dense_engine(dense_config);
+    assert(dense_engine.bids().ladder_backend() == LadderBackend::DENSE);
+
+    auto off_grid = dense_engine.submit({1000, Side::BUY, px(100.005), 1});
+    assert(!off_grid.accepted);
+    assert(off_grid.reject_reason == RejectReason::INVALID_PRICE);
+
+    for (const Order& order : {Order{1001, Side::BUY, px(100.00), 2}, Order{1002, Side::BUY, px(100.02), 3},
+                               Order{1003, Side::BUY, px(95.00), 4}, Order{1004, Side::SELL, px(101.00), 5},
+                               Order{1005, Side::SELL, px(130.00), 6}}) {
+        const SubmitResult rested = dense_engine.submit(order);
+        assert(rested.accepted);
+    }
+    assert(dense_engine.bids().best_price_ticks() == px(100.02));
+    assert(dense_engine.asks().best_price_ticks() == px(101.00));
+
+    auto dense_snapshot = dense_engine.depth(5);
+    assert(dense_snapshot.bids.size() == 3);
+    assert(dense_snapshot.bids[0].price_ticks == px(100.02));
+    assert(dense_snapshot.bids[1].price_ticks == px(100.00));
+    assert(dense_snapshot.bids[2].price_ticks == px(95.00));
+    assert(dense_snapshot.asks.size() == 2);
+    assert(dense_snapshot.asks[1].price_ticks == px(130.00));
+    assert(dense_snapshot.asks[1].quantity == 6);
+
+    const bool dense_cancelled = dense_engine.cancel(1002);
+    assert(dense_cancelled);
+    assert(dense_engine.bids().best_price_ticks() == px(100.00));
+    auto dense_sweep = dense_engine.submit({1006, Side::SELL, px(90.00), 7});
+    assert(dense_sweep.trades.size() == 2);
+    assert(dense_sweep.trades[1].buy_order_id == 1003);
+    assert(dense_engine.bids().empty());
+    assert(dense_engine.asks().best_price_ticks() == px(90.00));
+    assert(dense_engine.asks().best_order().quantity == 1);
+
+    // An outlier price next to a resting book is refused instead of growing the window to
+    // span it; a replace to such a price leaves the original order resting.
+    EngineConfig capped_config = dense_config;
+    capped_config.book.dense_max_levels = 1000;
+    MatchingEngine capped_engine(capped_config);
+    const SubmitResult capped_bid = capped_engine.submit({1100, Side::BUY, px(100.00), 2});
+    const SubmitResult capped_ask = capped_engine.submit({1101, Side::SELL, px(101.00), 2});
+    assert(capped_bid.accepted && capped_ask.accepted);
+    const PriceTicks outlier = PriceTicks{1000000000000000};
+    auto far_sell = capped_engine.submit({1102, Side::SELL, outlier, 1});
+    assert(!far_sell.accepted && far_sell.reject_reason == RejectReason::INVALID_PRICE);
+    auto far_replace = capped_engine.replace(1100, px(0.01), 2);
+    assert(!far_replace.accepted && far_replace.reject_reason == RejectReason::INVALID_PRICE);
+    assert(capped_engine.has_order(1100));
+    assert(capped_engine.bids().best_price_ticks() == px(100.00));
+    const SubmitResult band_edge = capped_engine.submit({1103, Side::SELL, px(110.99), 1});
+    assert(band_edge.accepted);
+    const SubmitResult past_band = capped_engine.submit({1104, Side::SELL, px(111.00), 1});
+    assert(!past_band.accepted);
+    assert(capped_engine.asks().level_count() == 2);
+    // Once the far level leaves, the band shrinks back and the same price fits again.
+    const bool band_edge_cancelled = capped_engine.cancel(1103);
+    assert(band_edge_cancelled);
+    const SubmitResult inside_band = capped_engine.submit({1104, Side::SELL, px(105.00), 1});
+    assert(inside_band.accepted);
+    EngineConfig unbounded_map;
+    MatchingEngine map_outlier_engine(unbounded_map);
+    const SubmitResult map_bid = map_outlier_engine.submit({1100, Side::BUY, px(100.00), 2});
+    const SubmitResult map_far_sell = map_outlier_engine.submit({1102, Side::SELL, outlier, 1});
+    assert(map_bid.accepted && map_far_sell.accepted);
+
+    // Only a resting remainder is span-checked: a far-away limit that fills in full trades on
+    // both backends, and a reused id is still DUPLICATE_ORDER_ID. A partial fill keeps its
+    // trades on the dense side but drops the remainder the map side would rest.
+    MatchingEngine far_map(unbounded_map);
+    MatchingEngine far_dense(capped_config);
+    for (MatchingEngine* far_engine : {&far_map, &far_dense}) {
+        const SubmitResult bid = far_engine->submit({1200, Side::BUY, px(100.00), 2});
+        const SubmitResult ask = far_engine->submit({1201, Side::SELL, px(101.00), 3});
+        assert(bid.accepted && ask.accepted);
+    }
+    const Order far_buy{1202, Side::BUY, outlier, 3};
+    const Order reused_id{1200, Side::BUY, outlier, 1};
+    for (const Order& order : {far_buy, reused_id}) {
+        const SubmitResult map_result = far_map.submit(order);
+        const SubmitResult dense_result = far_dense.submit(order);
+        assert(map_result.accepted == dense_result.accepted);
+        assert(map_result.reject_reason == dense_result.reject_reason);
+        assert(map_result.trades.size() == dense_result.trades.size());
+        if (order.id == far_buy.id) {
+            assert(dense_result.accepted && dense_result.trades.size() == 1);
+        } else {
+            assert(dense_result.reject_reason == RejectReason::DUPLICATE_ORDER_ID);
+        }
+    }
+    assert(far_dense.asks().empty() && !far_dense.has_order(1202));
+
+    const SubmitResult small_ask = far_dense.submit({1203, Side::SELL, px(101.00), 1});
+    assert(small_ask.accepted);
+    const SubmitResult partial = far_dense.submit({1204, Side::BUY, outlier, 2});
+    assert(partial.accepted && partial.trades.size() == 1);
+    assert(!far_dense.has_order(1204));
+    assert(far_dense.bids().best_price_ticks() == px(100.00));
+
+    // Likewise a replace to a far price that trades in full, unlike far_replace above.
+    const SubmitResult replace_ask = far_dense.submit({1205, Side::SELL, px(101.00), 2});
+    assert(replace_ask.accepted);
+    const SubmitResult far_lift = far_dense.replace(1200, outlier, 2);
+    assert(far_lift.accepted && far_lift.trades.size() == 1);
+    assert(far_dense.bids().empty() && far_dense.asks().empty());
+
+    EngineConfig map_config;
+    map_config.book.ladder = LadderBackend::MAP;
+    MatchingEngine map_twin(map_config);
+    MatchingEngine dense_twin(dense_config);
+    std::uint64_t ladder_lcg = 12345;
+    for (int i = 0; i < 20000; ++i) {
+        const int id = 20000 + i;
+        const std::uint64_t action = next_random(ladder_lcg, 10);
+        if (action < 2 && i > 0) {
+            const int target = 20000 + static_cast<int>(next_random(ladder_lcg, static_cast<std::uint64_t>(i)));
+            const bool map_cancelled = map_twin.cancel(target);
+            const bool dense_cancelled_twin = dense_twin.cancel(target);
+            assert(map_cancelled == dense_cancelled_twin);
+            continue;
+        }
+
+        const Side side = next_random(ladder_lcg, 2) == 0 ? Side::BUY : Side::SELL;
+        const PriceTicks drift = static_cast<PriceTicks>(i / 50) * px(0.01);
+        const PriceTicks offset = static_cast<PriceTicks>(next_random(ladder_lcg, 40)) * px(0.01);
+        const PriceTicks price =
+            side == Side::BUY ? px(100.0) + drift - offset + px(0.05) : px(100.0) + drift + offset - px(0.05);
+        const int quantity = 1 + static_cast<int>(next_random(ladder_lcg, 9));
+        auto map_result = map_twin.submit({id, side, price, quantity});
+        auto dense_result = dense_twin.submit({id, side, price, quantity});
+        assert(map_result.accepted == dense_result.accepted);
+        assert(map_result.trades.size() == dense_result.trades.size());
+        for (std::size_t t = 0; t < map_result.trades.size(); ++t) {
+            assert(map_result.trades[t].buy_order_id == dense_result.trades[t].buy_order_id);
+            assert(map_result.trades[t].sell_order_id == dense_result.trades[t].sell_order_id);
+            assert(map_result.trades[t].price_ticks == dense_result.trades[t].price_ticks);
+            assert(map_result.trades[t].quantity == dense_result.trades[t].quantity);
+        }
+    }
+    auto map_depth = map_twin.depth(1000);
+    auto dense_depth = dense_twin.depth(1000);
+    assert(map_depth.bids.size() == dense_depth.bids.size());
+    assert(map_depth.asks.size() == dense_depth.asks.size());
+    for (std::size_t i = 0; i < map_depth.bids.size(); ++i) {
+        assert(map_depth.bids[i].price_ticks == dense_depth.bids[i].price_ticks);
+        assert(map_depth.bids[i].quantity == dense_depth.bids[i].quantity);
+        assert(map_depth.bids[i].order_count == dense_depth.bids[i].order_count);
+    }
+    for (std::size_t i = 0; i < map_depth.asks.size(); ++i) {
+        assert(map_depth.asks[i].price_ticks == dense_depth.asks[i].price_ticks);
+        assert(map_depth.asks[i].quantity == dense_depth.asks[i].quantity);
+        assert(map_depth.asks[i].order_count == dense_depth.asks[i].order_count);
+    }
+
+    MatchingEngine sink_engine;
+    for (const Order& order : {Order{1100, Side::SELL, px(100.0), 2}, Order{1101, Side::SELL, px(100.5), 3},
+                               Order{1102, Side::BUY, px(99.0), 4}}) {
+        const SubmitResult rested = sink_engine.submit(order);
+        assert(rested.accepted);
+    }
+    std::vector<Trade> streamed;
+    auto sink_result = sink_engine.submit({1103, Side::BUY, px(101.0), 4},
+                                          [&streamed](const Trade& trade) { streamed.push_back(trade); });
+    assert(sink_result.accepted);
+    assert(sink_result.trades.empty());
+    assert(streamed.size() == 2);
+    assert(streamed[0].sell_order_id == 1100 && streamed[0].quantity == 2);
+    assert(streamed[1].sell_order_id == 1101 && streamed[1].quantity == 2);
+    assert(streamed[1].price_ticks == px(100.5));
+
+    int streamed_quantity = 0;
+    auto sink_replace = sink_engine.replace(1102, px(100.5), 4,
+                                            [&streamed_quantity](const Trade& trade) {
+                                                streamed_quantity += trade.quantity;
+                                            });
+    assert(sink_replace.accepted);
+    assert(sink_replace.trades.empty());
+    assert(streamed_quantity == 1);
+    assert(sink_engine.bids().best_order().quantity == 3);
+
+    EngineConfig ring_config;
+    ring_config.event_log_mode = EventLogMode::RING;
+    ring_config.event_log_capacity = 4;
+    MatchingEngine ring_engine(ring_config);
+    const std::filesystem::path spill_path =
+        std::filesystem::temp_directory_path() / "matching_engine_event_spill.bin";
+    std::string spill_error;
+    const bool spilling = ring_engine.spill_evicted_events(spill_path.string(), spill_error);
+    assert(spilling);
+    for (int i = 0; i < 10; ++i) {
+        const SubmitResult rested = ring_engine.submit({1200 + i, Side::BUY, px(90.0) + i, 1});
+        assert(rested.accepted);
+    }
+    assert(ring_engine.last_seq_num() == 10);
+    assert(ring_engine.event_log().size() == 4);
+    assert(ring_engine.event_log().evicted_count() == 6);
+    assert(ring_engine.event_log()[0].seq_num == 7);
+    assert(ring_engine.event_log()[3].order_id().value() == 1209);
+    assert(ring_engine.events_since(0).size() == 4);
+    assert(ring_engine.events_since(10).empty());
+    auto ring_tail = ring_engine.events_since(8);
+    assert(ring_tail.size() == 2);
+    assert(ring_tail.front().seq_num == 9);
+    assert(ring_tail.back().seq_num == 10);
+    std::uint64_t expected_seq = 7;
+    for (const auto& event : ring_engine.events_since(6)) {
+        assert(event.seq_num == expected_seq++);
+    }
+    assert(expected_seq == 11);
+    // Iterators copy the range's segments, so they stay usable after the temporary range.
+    const auto ring_begin = ring_engine.events_since(6).begin();
+    assert(ring_begin->seq_num == 7 && ring_begin[3].seq_num == 10);
+    const bool flushed = ring_engine.flush_event_spill(spill_error);
+    assert(flushed);
+    assert(!ring_engine.event_log().spill_failed());
+
+    MatchingEngine closed_ring = std::move(ring_engine);
+    assert(closed_ring.event_log().size() == 4);
+    closed_ring = MatchingEngine();
+    std::vector<BookEvent> spilled;
+    const bool loaded = load_event_spill(spill_path.string(), spilled, spill_error);
+    assert(loaded);
+    assert(spilled.size() == 6);
+    for (std::size_t i = 0; i < spilled.size(); ++i) {
+        assert(spilled[i].seq_num == i + 1);
+        assert(spilled[i].type == BookEventType::ADD);
+        assert(spilled[i].order_id().value() == 1200 + static_cast<int>(i));
+    }
+    std::filesystem::remove(spill_path);
+
+    // A spill write that fails (here, to a full device) is latched and reported.
+    if (std::filesystem::exists("/dev/full")) {
+        MatchingEngine full_engine(ring_config);
+        const bool full_spilling = full_engine.spill_evicted_events("/dev/full", spill_error);
+        assert(full_spilling);
+        for (int i = 0; i < 10; ++i) {
+            const SubmitResult rested = full_engine.submit({1200 + i, Side::BUY, px(90.0) + i, 1});
+            assert(rested.accepted);
+        }
+        const bool full_flushed = full_engine.flush_event_spill(spill_error);
+        assert(!full_flushed);
+        assert(spill_error.find("/dev/full") != std::string::npos);
+        assert(full_engine.event_log().spill_failed());
+    }
+
+    EngineConfig silent_config;
+    silent_config.event_log_mode = EventLogMode::OFF;
+    MatchingEngine silent_engine(silent_config);
+    const SubmitResult silent_ask = silent_engine.submit({1300, Side::SELL, px(100.0), 2});
+    assert(silent_ask.accepted);
+    const SubmitResult silent_lift = silent_engine.submit({1301, Side::BUY, px(100.0), 1});
+    assert(silent_lift.trades.size() == 1);
+    const bool silent_cancelled = silent_engine.cancel(1300);
+    assert(silent_cancelled);
+    assert(silent_engine.last_seq_num() == 3);
+    assert(silent_engine.event_log().empty());
+    assert(silent_engine.events_since(0).empty());
+
+    MatchingEngine full_engine;
+    assert(full_engine.event_log_mode() == EventLogMode::FULL);
+    for (int i = 0; i < 100; ++i) {
+        const SubmitResult rested = full_engine.submit({1400 + i, Side::SELL, px(100.0) + i, 1});
+        assert(rested.accepted);
+    }
+    assert(full_engine.event_log().size() == 100);
+    assert(full_engine.event_log().evicted_count() == 0);
+
+    MatchingEngine level_sweep_engine;
+    for (int i = 0; i < 6; ++i) {
+        const SubmitResult rested = level_sweep_engine.submit({1500 + i, Side::SELL, px(100.0) + (i / 3), 2});
+        assert(rested.accepted);
+    }
+    auto level_sweep = level_sweep_engine.submit({1510, Side::BUY, 0, 8, TimeInForce::IOC, OrderType::MARKET});
+    assert(level_sweep.trades.size() == 4);
+    for (int i = 0; i < 4; ++i) {
+        assert(level_sweep.trades[i].sell_order_id == 1500 + i);
+        assert(level_sweep.trades[i].quantity == 2);
+    }
+    assert(level_sweep_engine.asks().level_count() == 1);
+    assert(level_sweep_engine.asks().order_count() == 2);
+    assert(level_sweep_engine.order_index().size() == 2);
+    assert(!level_sweep_engine.has_order(1502));
+    assert(level_sweep_engine.top_of_book().best_ask->quantity == 4);
+    assert(level_sweep_engine.top_of_book().best_ask->order_count == 2);
+    // Nodes returned as a chain are reused by later orders.
+    const std::size_t sweep_pool_capacity = level_sweep_engine.asks().order_pool().capacity();
+    for (int i = 0; i < 4; ++i) {
+        const SubmitResult reused = level_sweep_engine.submit({1520 + i, Side::SELL, px(99.0), 1});
+        assert(reused.accepted);
+    }
+    assert(level_sweep_engine.asks().order_pool().capacity() == sweep_pool_capacity);
+    assert(level_sweep_engine.asks().best_order().id == 1520);
+
+    MatchingEngine handle_engine;
+    auto rested = handle_engine.submit({1600, Side::BUY, px(99.0), 5});
+    assert(rested.handle.valid());
+    assert(rested.handle.side == Side::BUY);
+    auto crossed = handle_engine.submit({1601, Side::SELL, px(99.0), 5});
+    assert(!crossed.handle.valid());
+    // The buy was consumed with its whole level, so its handle is stale now.
+    const bool stale_cancelled = handle_engine.cancel(rested.handle);
+    assert(!stale_cancelled);
+    auto stale_replace = handle_engine.replace(rested.handle, px(99.0), 1);
+    assert(!stale_replace.accepted);
+    assert(stale_replace.reject_reason == RejectReason::ORDER_NOT_FOUND);
+
+    auto ask_a = handle_engine.submit({1602, Side::SELL, px(101.0), 4});
+    auto ask_b = handle_engine.submit({1603, Side::SELL, px(101.0), 4});
+    auto kept = handle_engine.replace(ask_a.handle, px(101.0), 2);
+    assert(kept.accepted);
+    assert(kept.handle.node == ask_a.handle.node && kept.handle.generation == ask_a.handle.generation);
+    assert(handle_engine.asks().best_order().id == 1602);
+    auto moved = handle_engine.replace(ask_a.handle, px(102.0), 2);
+    assert(moved.accepted);
+    assert(moved.handle.valid());
+    const bool moved_from_cancelled = handle_engine.cancel(ask_a.handle);
+    assert(!moved_from_cancelled);
+    assert(handle_engine.has_order(1602));
+    const bool moved_cancelled = handle_engine.cancel(moved.handle);
+    assert(moved_cancelled);
+    assert(!handle_engine.has_order(1602));
+    const bool gone_cancelled = handle_engine.cancel(1602);
+    assert(!gone_cancelled);
+    const SubmitResult gone_replace = handle_engine.replace(1602, px(101.0), 1);
+    assert(gone_replace.reject_reason == RejectReason::ORDER_NOT_FOUND);
+    // The id is free again once its order is gone.
+    const SubmitResult freed_id = handle_engine.submit({1602, Side::SELL, px(103.0), 1});
+    assert(freed_id.accepted);
+    const bool reused_cancelled = handle_engine.cancel(1602);
+    assert(reused_cancelled);
+    const bool ask_b_cancelled = handle_engine.cancel(ask_b.handle);
+    assert(ask_b_cancelled);
+    assert(handle_engine.asks().empty());
+    assert(!handle_engine.has_order(1603));
+
+    MatchingEngine by_handle;
+    MatchingEngine by_id;
+    std::unordered_map<int, OrderHandle> handles;
+    std::vector<int> handle_ids;
+    std::uint64_t handle_lcg = 4242;
+    for (int i = 0; i < 30000; ++i) {
+        const std::uint64_t action = next_random(handle_lcg, 10);
+        if (action < 4 && !handle_ids.empty()) {
+            const int id = handle_ids[next_random(handle_lcg, handle_ids.size())];
+            const OrderHandle handle = handles[id];
+            if (action < 3) {
+                const bool handle_cancelled = by_handle.cancel(handle);
+                const bool id_cancelled = by_id.cancel(id);
+                assert(handle_cancelled == id_cancelled);
+            } else {
+                const PriceTicks new_price = px(100.0) + static_cast<PriceTicks>(next_random(handle_lcg, 20)) - 10;
+                const int new_quantity = 1 + static_cast<int>(next_random(handle_lcg, 5));
+                auto handle_result = by_handle.replace(handle, new_price, new_quantity);
+                auto id_result = by_id.replace(id, new_price, new_quantity);
+                assert(handle_result.accepted == id_result.accepted);
+                assert(handle_result.reject_reason == id_result.reject_reason);
+                assert(handle_result.trades.size() == id_result.trades.size());
+                handles[id] = handle_result.handle;
+            }
+            continue;
+        }
+
+        const int id = 30000 + i;
+        const Side side = next_random(handle_lcg, 2) == 0 ? Side::BUY : Side::SELL;
+        const PriceTicks price = px(100.0) + static_cast<PriceTicks>(next_random(handle_lcg, 20)) - 10;
+        const int quantity = 1 + static_cast<int>(next_random(handle_lcg, 5));
+        auto handle_result = by_handle.submit({id, side, price, quantity});
+        auto id_result = by_id.submit({id, side, price, quantity});
+        assert(handle_result.trades.size() == id_result.trades.size());
+        if (handle_result.handle.valid()) {
+            handles[id] = handle_result.handle;
+            handle_ids.push_back(id);
+        }
+    }
+    assert(by_handle.bids().order_count() == by_id.bids().order_count());
+    assert(by_handle.asks().order_count() == by_id.asks().order_count());
+    for (const int id : handle_ids) {
+        assert(by_handle.has_order(id) == by_id.has_order(id));
+    }
+    // Stale entries are purged instead of growing the index without bound.
+    assert(by_handle.order_index().capacity() <= 4 * by_id.order_index().capacity());
+
+    EngineConfig batch_config;
+    batch_config.book.ladder = LadderBackend::DENSE;
+    batch_config.book.dense_tick_size = px(0.01);
+    MatchingEngine batched(batch_config);
+    MatchingEngine one_by_one(batch_config);
+    std::vector<EngineAction> batch;
+    std::uint64_t batch_lcg = 777;
+    for (int i = 0; i < 5000; ++i) {
+        EngineAction action;
+        const std::uint64_t kind = next_random(batch_lcg, 10);
+        const int target = 40000 + static_cast<int>(next_random(batch_lcg, static_cast<std::uint64_t>(i + 1)));
+        // A few prices off the 0.01 grid and a few non-positive quantities exercise pass 1.
+        const PriceTicks price = px(100.0) + static_cast<PriceTicks>(next_random(batch_lcg, 40)) * px(0.01) -
+                                 px(0.2) + (next_random(batch_lcg, 50) == 0 ? 1 : 0);
+        const int quantity = static_cast<int>(next_random(batch_lcg, 8)) - (next_random(batch_lcg, 40) == 0 ? 8 : 0);
+        if (kind < 2) {
+            action.type = EngineActionType::CANCEL;
+            action.order.id = target;
+        } else if (kind < 4) {
+            action.type = EngineActionType::REPLACE;
+            action.order.id = target;
+            action.new_price_ticks = price;
+            action.new_quantity = quantity;
+        } else {
+            const Side side = next_random(batch_lcg, 2) == 0 ? Side::BUY : Side::SELL;
+            const bool market = next_random(batch_lcg, 20) == 0;
+            action.order = {40000 + i, side, market ? 0 : price, quantity, TimeInForce::GTC,
+                            market ? OrderType::MARKET : OrderType::LIMIT};
+        }
+        batch.push_back(action);
+    }
+
+    std::vector<ActionResult> batch_results(batch.size());
+    std::vector<Trade> batch_trades;
+    batched.process_batch(batch.data(), batch.size(), batch_results.data(), batch_trades);
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        const EngineAction& action = batch[i];
+        SubmitResult expected;
+        if (action.type == EngineActionType::NEW) {
+            expected = one_by_one.submit(action.order);
+        } else if (action.type == EngineActionType::CANCEL) {
+            expected.accepted = one_by_one.cancel(action.order.id);
+            expected.reject_reason = expected.accepted ? RejectReason::NONE : RejectReason::ORDER_NOT_FOUND;
+        } else {
+            expected = one_by_one.replace(action.order.id, action.new_price_ticks, action.new_quantity);
+        }
+
+        const ActionResult& got = batch_results[i];
+        assert(got.accepted == expected.accepted);
+        assert(got.reject_reason == expected.reject_reason);
+        assert(got.handle.valid() == expected.handle.valid());
+        assert(got.trade_count == expected.trades.size());
+        for (std::size_t t = 0; t < got.trade_count; ++t) {
+            const Trade& trade = batch_trades[got.first_trade + t];
+            assert(trade.buy_order_id == expected.trades[t].buy_order_id);
+            assert(trade.sell_order_id == expected.trades[t].sell_order_id);
+            assert(trade.price_ticks == expected.trades[t].price_ticks);
+            assert(trade.quantity == expected.trades[t].quantity);
+        }
+    }
+    assert(batched.last_seq_num() == one_by_one.last_seq_num());
+    assert(batched.bids().order_count() == one_by_one.bids().order_count());
+    assert(batched.asks().order_count() == one_by_one.asks().order_count());
+
     std::cout << "All matching tests passed.\n";
     return 0;
 }